@@ -0,0 +1,39 @@
+// 
+// -----------------------------------------------------------------------------
+// atom.h
+// -----------------------------------------------------------------------------
+//
+// Copyright (c) 2022 Tyler Wayne
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef ATOM_INCLUDED
+#define ATOM_INCLUDED
+
+/**
+ * Atoms are unique, immutable strings. Interning the same string twice
+ * returns the same pointer, so atoms can be compared with ==. Atoms live
+ * until the program exits and must not be freed.
+ */
+extern const char *atomNew(const char *str, const int len);
+extern const char *atomString(const char *str);
+
+/**
+ * Returns the atom for str if it's been interned, or NULL otherwise,
+ * without interning it
+ */
+extern const char *atomFind(const char *str);
+extern int         atomLength(const char *atom);
+
+#endif // ATOM_INCLUDED
@@ -41,4 +41,12 @@ extern int  writeUpdates(list_T, const char *filename);
 extern int  backendCheck(const list_T, const char *filename);
 extern int  backendCreate(list_T, const char *filename);
 
+/**
+ * Sets *names to an array of the names of the lists (tables) in filename,
+ * in alphabetical order, and *nnames to its length. The names are atoms,
+ * so only the array has to be freed with memFree.
+ */
+extern int  readListNames(const char *filename, const char ***names,
+              int *nnames);
+
 #endif // BACKEND_SQLITE3_INCLUDED
@@ -0,0 +1,61 @@
+//
+// -----------------------------------------------------------------------------
+// filter.h
+// -----------------------------------------------------------------------------
+//
+// Copyright (c) 2022 Tyler Wayne
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef FILTER_INCLUDED
+#define FILTER_INCLUDED
+
+#include "task.h" // task_T
+
+/**
+ * A filter is a query of terms separated by spaces, e.g.,
+ * "category=Work priority=P0 due<=2022-06-30", and a task matches it if
+ * it matches every term. A term compares the value of a key with one of
+ * =, !=, <, <=, > or >=. Values are compared as strings, so dates in
+ * ISO format order as they should. A value is quoted with '' if it has
+ * spaces, and a task without the key has the value "". A category also
+ * equals the categories nested in it, so "category=Work" matches tasks
+ * in "Work/ClientA".
+ */
+typedef struct filter_T *filter_T;
+
+/**
+ * Returns NULL if query is empty or a term isn't a key, an operator and
+ * a value
+ */
+extern filter_T filterNew(const char *query);
+
+/**
+ * Whether one of the filter's terms is on key
+ */
+extern int      filterHasKey(const filter_T, const char *key);
+extern int      filterMatch(const filter_T, task_T);
+
+/**
+ * These check one term of the filter against a value rather than a task,
+ * so a term can be checked once for each distinct value of its key, as
+ * listFilterTasks does with the list's columns
+ */
+extern int      filterNumTerms(const filter_T);
+extern const char *filterTermKey(const filter_T, const int term);
+extern int      filterTermMatch(const filter_T, const int term,
+                  const char *val);
+extern void     filterFree(filter_T *);
+
+#endif // FILTER_INCLUDED
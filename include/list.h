@@ -23,71 +23,331 @@
 #ifndef LIST_INCLUDED
 #define LIST_INCLUDED
 
-#include "task.h" // task_T
+#include "task.h"   // task_T
+#include "filter.h" // filter_T
 
 // TODO: make naming of linked list heads consistent
 // some use the singular, some use the plural
 struct cat_T {
-  char         *name;     // name of the category
+  const char   *name;     // name of the category, an atom
+  const char   *label;    // last part of name, after the categories it's in
   int           ntasks;   // number of tasks in the task linked list
   int           nopen;    // number of tasks that haven't been completed
+  int           nbranch_open; // open tasks in it and categories nested in it
+  int           folded;   // whether its tasks and nested categories are hidden
   task_T        tasks;    // task linked list
   struct cat_T *link;     // link to next category
+  struct cat_T *parent;   // category it's nested in
+  struct cat_T *child;    // first category nested in it
+  struct cat_T *sibling;  // next category nested in the same one
+};
+
+/**
+ * Hash table of tasks by id, or by address when by_task is set, kept at
+ * most half full
+ */
+struct taskIndex {
+  task_T       *tasks;    // tasks, or NULL for empty slots
+  int           len;      // length of tasks, a power of 2
+  int           n;        // number of tasks in the table
+  int           by_task;  // whether tasks without ids are held too
+};
+
+// Keys the list looks up on every task, whose slots are cached
+enum listSlots {
+  LS_ID       = 0,
+  LS_PARENTID = 1,
+  LS_CATEGORY = 2,
+  LS_STATUS   = 3,
+  LS_POSITION = 4,
+  LS_NSLOTS   = 5
 };
 
 struct list_T {
   char         *name;     // name of list
-  char        **keys;     // array of keys each of the tasks should have
+  const char  **keys;     // array of keys (atoms) each task should have
   int           nkeys;    // number of keys
   int           keys_len; // length of keys array
+  int           slots[LS_NSLOTS]; // slots of the keys in listSlots, or -1
   int           ntasks;   // number of tasks
   int           nupdates; // number of updates
   int           maxid;    // highest id of all tasks 
   int           ncats;    // number of categories
   struct cat_T *cat;      // categories linked list
+  struct cat_T *cat_tree; // top-level categories, linked by sibling
+  taskPool_T    pool;     // pool the tasks of the list are allocated from
+  arena_T       arena;    // arena holding the list, its categories and tasks
+  struct taskIndex index; // tasks by id
+  struct cat_T **cat_index; // hash table of categories by name
+  task_T        dirty;    // updated tasks, most recent first, linked by dirty
+  int           cat_index_len; // length of cat_index, a power of 2
+  struct journal *journal; // changes to undo and redo, see listSetHistory
+  struct view_T *views;   // saved views, see listAddView
+  struct columns *columns; // fields by key in arrays, see listSetColumns
 };
 
 typedef struct cat_T *cat_T;
 typedef struct list_T *list_T;
+typedef struct view_T *view_T;
 
-extern task_T  taskFindChildById(const task_T, const char *id);
+extern task_T  taskFindChildById(const task_T, const int id);
 
-extern char   *catName(const cat_T);
+extern const char *catName(const cat_T);
 extern task_T  catGetTask(const cat_T, const task_T);
 extern int     catNumOpen(const cat_T);
 
+/**
+ * Categories nest by name, so "Work/ClientA" is in "Work", which is
+ * made without any tasks of its own if it doesn't exist. The label is
+ * the part after the last '/', e.g., "ClientA". catNumBranchOpen counts
+ * the open tasks of a category and every category nested in it, and
+ * is kept as tasks change, so it takes constant time.
+ */
+extern const char *catLabel(const cat_T);
+extern int     catNumBranchOpen(const cat_T);
+extern int     catIsFolded(const cat_T);
+extern void    catSetFolded(cat_T, const int folded);
+
+/**
+ * A task iterator walks the tasks of a category, or a task and the tasks
+ * below it, depth first. It follows parent links instead of recursing,
+ * so it takes the same space however wide or deep the tree is. After
+ * a task is returned, taskIterSkip prunes the tasks below it from the
+ * walk. depth is the depth of the last task returned below where the
+ * walk started, i.e., its level for a category.
+ */
+struct taskIter {
+  task_T root;  // task whose subtree is walked, or NULL for a category
+  task_T task;  // last task returned
+  task_T first; // first task to return
+  int    depth; // depth of task
+  int    skip;  // whether to skip the tasks below task
+};
+
+extern void    catIterInit(struct taskIter *, const cat_T);
+extern void    taskIterInit(struct taskIter *, const task_T root);
+extern task_T  taskIterNext(struct taskIter *);
+extern void    taskIterSkip(struct taskIter *);
+
 extern list_T  listNew(const char *);
 
+/**
+ * Allocates a task from the list's pool, with a field for each of the
+ * list's keys set to "". It isn't added to the list until it's passed to
+ * listSetTask.
+ */
+extern task_T  listNewTask(list_T);
+
 /**
  * Tasks are set by their ids. Because this data is stored in the task itself,
  * it doesn't not need to be passed as an argument. We set tasks at the list
  * level and not the category level because a task's category can change, 
- * in which case it needs to be relocated in the list.
+ * in which case it needs to be relocated in the list. If the list has
+ * a "position" key, the task goes before the first sibling with a later
+ * position, and a task without one goes first and is given a position
+ * before the others.
  */
 extern int     listSetTask(list_T, task_T);
+
+/**
+ * Adds tasks in bulk, in time linear to their number, as when reading a
+ * list from a backend. Tasks are linked under their parents whether or
+ * not the parents come first. Tasks whose parents don't exist, or that
+ * are their own ancestors, are reported on stderr and placed at the top
+ * of their categories. Completed tasks are freed rather than added.
+ * Each task goes before the siblings added ahead of it, so tasks given
+ * in descending position end up in order without sorting.
+ */
+extern int     listBulkLoad(list_T, task_T *tasks, const int ntasks);
+
+/**
+ * Moves task past the next sibling before it, for offset < 0, or after
+ * it that's still shown, i.e., not complete or deleted. Only the
+ * position of task changes, to one between its new neighbors, unless
+ * they don't have positions yet. Then each of the siblings is given
+ * one. Returns TD_INVALIDARG if the list has no "position" key or
+ * there's no sibling to move past.
+ */
+extern int     listMoveTask(list_T, task_T task, const int offset);
+
+/**
+ * Moves task and its subtasks to follow prev under parent, or to be
+ * the first of its siblings if prev is NULL. A top-level task goes in
+ * category, or stays in its own if category is NULL, and subtasks go
+ * in the category of their parent. Only task is relinked, so this takes
+ * constant time unless the category changes and each of the subtasks
+ * has to be written. Returns TD_INVALIDARG if parent is in the subtree
+ * of task or prev isn't one of its children.
+ */
+extern int     listMoveSubtree(list_T, task_T task, task_T parent,
+                 task_T prev, const char *category);
+
+/**
+ * Moves task to be the last subtask of the sibling before it, or out
+ * to follow its parent. Returns TD_INVALIDARG if there's no sibling
+ * shown before task, or task isn't a subtask.
+ */
+extern int     listIndentTask(list_T, task_T task);
+extern int     listOutdentTask(list_T, task_T task);
+
+/**
+ * Copies task and all of its descendants in one pass, leaving out any
+ * that are marked complete or deleted. The copy is placed under parent,
+ * or at the top of category if parent is NULL (task's category if that's
+ * NULL too). Its tasks are given fresh ids and flagged as new, so a single
+ * save persists all of them. Returns the copy of task.
+ */
+extern task_T  listCloneSubtree(list_T, const task_T task, task_T parent, 
+  const char *category);
 extern int     listAddKey(list_T, const char *key);
 extern int     listNumKeys(const list_T);
-extern char  **listGetKeys(const list_T);
+extern const char **listGetKeys(const list_T);
 extern int     listContainsKey(const list_T, const char *key);
+
+/**
+ * Returns the slot of key in the tasks of the list, or -1 if the list
+ * doesn't have the key. See taskGetSlot.
+ */
+extern int     listKeySlot(const list_T, const char *key);
+
+/**
+ * Tasks in a list conform to its keys, so the fields in listSlots are
+ * fetched by slot rather than searched for by key. ind is one of listSlots.
+ */
+extern char   *listTaskGet(const list_T, const task_T, const int ind);
 extern char   *listName(const list_T);
 
+/**
+ * Returns the number of bytes held by the list, its tasks and its
+ * indexes. Most of it is the arena, so this takes constant time.
+ */
+extern long    listSize(const list_T);
+
 /**
  * If cat is NULL, returns the first category. If cat is not null, then
- * returns the next category.
+ * returns the next category. Categories are in alphabetical order.
  */
 extern cat_T   listGetCat(const list_T, const cat_T);
-extern task_T  listFindTaskById(const list_T, const char *id);
 
 /**
- * Returns an array of tasks that have been updated
+ * Walks the categories depth first by nesting, in alphabetical order
+ * within each category. Returns the category after cat, or the first
+ * top-level one if cat is NULL, and sets *depth to the number of
+ * categories it's nested in. If skip is set, the categories nested in
+ * cat are passed over.
+ */
+extern cat_T   listNextCat(const list_T, const cat_T cat, const int skip,
+                 int *depth);
+
+/**
+ * Tasks are found by id through a hash index, so the id of a task
+ * shouldn't be changed with taskSet once it's been added to the list
+ */
+extern task_T  listFindTaskById(const list_T, const int id);
+extern cat_T   listFindCat(const list_T, const char *name);
+
+/**
+ * Returns an array of tasks that have been updated, in the order they
+ * were first updated. Updated tasks are kept in their own linked list,
+ * so this and listClearUpdates take time linear to the number of updates
+ * rather than the size of the list.
  */
 extern task_T *listGetUpdates(const list_T list);
 extern int     listNumUpdates(const list_T list);
 extern int     listClearUpdates(list_T list);
+
+/**
+ * Frees the completed and deleted tasks that have been saved, along with
+ * their subtasks, so later walks of the list don't pass over them. Tasks
+ * are kept if they or any of their subtasks are open or have unsaved
+ * updates. Called after the updates have been written.
+ */
+extern int     listCompact(list_T list);
+
+/**
+ * Keeps the last depth changes made by listSetTask, listApply,
+ * listMoveTask, listMoveSubtree and listCloneSubtree, so that they can
+ * be undone and redone. Only the fields, flags and links a change
+ * touched are kept, and undoing or redoing it takes time linear to
+ * those, along with the depth of the tasks for their counts. Updates
+ * made by a change are unmarked when it's undone. The history is
+ * dropped when the updates are cleared, since the saved changes can't
+ * be undone, and when the list is compacted. A depth of 0, the default,
+ * keeps no history.
+ */
+extern int     listSetHistory(list_T, const int depth);
+
+/**
+ * Return TD_INVALIDARG if there's no change to undo or redo
+ */
+extern int     listUndo(list_T);
+extern int     listRedo(list_T);
 extern void    listFree(list_T *);
 extern int     listGetMaxId(const list_T);
 
-// TODO: can we combine these two functions?
+/**
+ * A saved view is a named filter on the list. The tasks in it are found
+ * with one walk of the list the first time they're asked for, and kept
+ * from then on as tasks change, where only the changed tasks are checked
+ * against the filter. Only shown tasks, those neither complete nor
+ * deleted, are in a view. Adding a view with the name of one the list
+ * already has replaces its filter. Returns NULL if query isn't a valid
+ * filter or filters on the position, which orders siblings.
+ */
+extern view_T  listAddView(list_T, const char *name, const char *query);
+extern view_T  listGetView(const list_T, const char *name);
+
+/**
+ * Returns the view after view, in the order they were added, or the
+ * first one if view is NULL
+ */
+extern view_T  listNextView(const list_T, const view_T);
+extern const char *viewName(const view_T);
+extern int     listViewNumTasks(list_T, view_T);
+
+/**
+ * Returns an array of the tasks in the view ending in NULL, by category
+ * and then by id. Takes time linear to the number of tasks in the view
+ * rather than the size of the list, once the view's been built.
+ */
+extern task_T *listViewGetTasks(list_T, view_T);
+
+/**
+ * Keeps a copy of the fields of the list's tasks in columns, one for each
+ * of the list's keys, when on is set, or drops it otherwise. A column
+ * gives each distinct value of its key a code and holds the code of each
+ * task in an array, so scanning it reads memory in order instead of
+ * following each task to its fields. The columns are filled the first
+ * time they're used and kept up to date as tasks change after that, at
+ * the cost of an array entry per key for each task, and a copy of each
+ * distinct value.
+ */
+extern int     listSetColumns(list_T, const int on);
+
+/**
+ * Returns an array of the tasks in the list that match the filter, ending
+ * in NULL, whether or not they're complete or deleted. With columns, each
+ * term is checked once for each distinct value of its key and then the
+ * codes are scanned; without, each task is checked in turn.
+ */
+extern task_T *listFilterTasks(list_T, const filter_T);
+
+enum listOp {
+  LO_SET      = 1, // set key to val
+  LO_COMPLETE = 2, // mark complete
+  LO_DELETE   = 3  // mark deleted
+};
+
+/**
+ * Applies op to each of the tasks, e.g., a selection or the result of a
+ * filter. Completing or deleting a task does the same to the tasks below
+ * it, and tasks already covered by a task earlier in the array are passed
+ * over. Setting a field changes only the tasks given, and isn't allowed
+ * for the id, parent_id, category or status, which place and count the
+ * task. Deleted tasks are left as they are.
+ */
+extern int     listApply(list_T, task_T *tasks, const int ntasks, const int op,
+                 const char *key, const char *val);
 extern int     markComplete(list_T, task_T);
 extern int     markDelete(list_T, task_T);
 
@@ -26,4 +26,22 @@ extern void *memCalloc(long count, long nbytes);
 extern void *memResize(void *ptr, long nbytes);
 extern void  memFree(void *ptr);
 
+/**
+ * An arena hands out memory by bumping a pointer through large blocks.
+ * Allocations can't be freed one at a time; they're all released
+ * together by arenaFree, in time proportional to the number of blocks.
+ * An allocation given back with arenaRelease, along with the size it was
+ * allocated with, is handed out again for the next one of the same size,
+ * unless it's over 512 bytes.
+ */
+typedef struct arena_T *arena_T;
+
+extern arena_T arenaNew();
+extern void   *arenaAlloc(arena_T, long nbytes);
+extern void   *arenaCalloc(arena_T, long count, long nbytes);
+extern char   *arenaStrdup(arena_T, const char *str);
+extern void    arenaRelease(arena_T, void *ptr, long nbytes);
+extern long    arenaSize(const arena_T);
+extern void    arenaFree(arena_T *);
+
 #endif // MEM_INCLUDED
@@ -0,0 +1,49 @@
+//
+// -----------------------------------------------------------------------------
+// position.h
+// -----------------------------------------------------------------------------
+//
+// Copyright (c) 2022 Tyler Wayne
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef POSITION_INCLUDED
+#define POSITION_INCLUDED
+
+#include <stddef.h> // size_t
+
+// Longest position made, including the '\0'
+#define POSITION_LEN 64
+
+/**
+ * Positions are strings that order tasks when compared with strcmp.
+ * A position is an integer part, a letter giving the number of digits
+ * followed by the digits, e.g., "a5" or "b12", and an optional fraction
+ * of digits without trailing zeros, e.g., "a5" < "a55" < "a6". There's
+ * always a position between any two, so moving a task only changes its
+ * own position, and one after or before the last or first one stays
+ * short.
+ */
+extern int positionIsValid(const char *pos);
+
+/**
+ * Writes a position between lo and hi to buf. lo is NULL for one before
+ * hi, and hi is NULL for one after lo. Returns TD_INVALIDARG if either
+ * is invalid or lo isn't before hi, and TD_BUFOVERFLOW if the position
+ * doesn't fit in len.
+ */
+extern int positionBetween(char *buf, const size_t len, const char *lo,
+             const char *hi);
+
+#endif // POSITION_INCLUDED
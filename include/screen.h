@@ -35,12 +35,15 @@ typedef struct screen_T {
   int nlines;
   int offset;
   line_T lines;
+  line_T tail;   // last line, so lines are appended in constant time
+  view_T view;   // saved view shown instead of the whole list, or NULL
 } *screen_T;
 
 extern screen_T screenNew();
 extern int      screenInitialize(screen_T, const list_T);
 extern int      screenReset(screen_T *, const list_T);
 extern line_T   screenGetLine(const screen_T, const int lineno);
+extern line_T   screenFindLine(const screen_T, const void *obj);
 extern void     screenFree(screen_T *);
 
 extern int      lineNum(const line_T);
@@ -0,0 +1,100 @@
+//
+// -----------------------------------------------------------------------------
+// session.h
+// -----------------------------------------------------------------------------
+//
+// Copyright (c) 2022 Tyler Wayne
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef SESSION_INCLUDED
+#define SESSION_INCLUDED
+
+#include "list.h" // list_T
+
+/**
+ * A session keeps the lists of one file that have been viewed, most
+ * recently used first, so that switching back to one doesn't read it
+ * again. Each list keeps where it was scrolled to and its unsaved
+ * updates while another is in view.
+ */
+struct sessionList {
+  list_T  list;
+  int     offset;              // screen offset when last in view
+  int     cur_row;             // cursor row when last in view
+  struct sessionList *prev;    // more recently used list
+  struct sessionList *next;    // less recently used list
+};
+
+// Saved views are given to each list, see listAddView
+struct sessionView {
+  char   *name;
+  char   *query;
+};
+
+typedef struct session_T {
+  char   *filename;
+  struct sessionList *head;    // list in view
+  struct sessionList *tail;    // least recently used list
+  int     nlists;
+  long    budget;              // bytes the lists should fit in
+  int     history;             // changes each list keeps to undo
+  struct sessionView *views;   // saved views each list has
+  int     nviews;
+} *session_T;
+
+extern session_T sessionNew(const char *filename, const long budget,
+                   const int history);
+
+/**
+ * Adds a saved view to each list that's loaded and each list loaded
+ * later. Returns TD_INVALIDARG if query isn't one listAddView takes.
+ */
+extern int       sessionAddView(session_T, const char *name,
+                   const char *query);
+
+/**
+ * Puts list in view, keeping the session's history and saved views for
+ * it with listSetHistory and listAddView. Lists are freed, least recently
+ * used first, until the rest fit in the session's budget, as measured by
+ * listSize. The list in view and lists with unsaved updates are never
+ * freed, so they may go over it.
+ */
+extern int       sessionAdd(session_T, list_T);
+
+/**
+ * Puts the list called name in view, reading it from the session's file
+ * if it isn't already loaded. Returns the return code of readTasks if
+ * it can't be read, leaving the list in view as it was.
+ */
+extern int       sessionSwitch(session_T, const char *name);
+
+extern struct sessionList *sessionCurrent(const session_T);
+
+/**
+ * Returns the list called name if it's loaded, without putting it in
+ * view, or NULL if it isn't
+ */
+extern list_T    sessionGetList(const session_T, const char *name);
+
+extern int       sessionNumUpdates(const session_T);
+
+/**
+ * Writes the updates of each list that has any. Returns the first
+ * error from writeUpdates, after trying the rest.
+ */
+extern int       sessionWriteUpdates(session_T);
+extern void      sessionFree(session_T *);
+
+#endif // SESSION_INCLUDED
@@ -22,9 +22,11 @@
 #define TASK_INCLUDED
 
 #include <stdbool.h> // bool
+#include <stdint.h>  // int32_t
+#include "mem.h"     // arena_T
 #include "task.h"    // task_T
 
-// These need to be multiples of 2
+// These need to be multiples of 2, and fit in the bits of flags in task_T
 enum taskFlags {
   TF_NEW      = 1,
   TF_UPDATE   = 2,
@@ -32,55 +34,170 @@ enum taskFlags {
   TF_DELETE   = 8
 };
 
+enum taskStatus {
+  TS_OPEN     = 0,
+  TS_COMPLETE = 1
+};
+
+// Value of the id fields of a task when they're empty or not a number
+#define TASK_NOID -1
+
+// Values shorter than this are held in the elem instead of being allocated
+#define ELEM_INLINE_LEN 15
+
 struct elem_T {
-  char *key;
-  char *val;
-  struct elem_T *link;
+  const char *key; // atom, see atom.h
+  char *val;       // value in the task's arena or on the heap, an atom, or
+                   // NULL if held in buf
+  char  buf[ELEM_INLINE_LEN];
+  char  is_atom;   // val is an atom, so it isn't freed
 };
 
+typedef struct taskPool_T *taskPool_T;
+
 struct task_T {
-  struct elem_T *head;   // head of linked list holding data
-  struct elem_T *tail;   // tail of data
+  struct elem_T *elems;  // array of key-value pairs, indexed by slot
+  int    nelems;         // number of slots in use
+  int    elems_len;      // length of elems array
   struct task_T *llink;  // next task in tasks linked list
   struct task_T *rlink;  // prev task in tasks linked list
   struct task_T *child;  // head of subtask linked list
   struct task_T *parent; // parent task, if there is one
-  int    level;         // depth of the task in the list tree
-  int    flags;         // flags for indicating changes to the task
+  struct task_T *dirty;  // next task in the list's updated tasks
+  int    level;         // depth when loaded or cloned, see taskGetLevel
+  int32_t row;          // row in the list's columns or 0, kept by list
+  int    nsubtasks;     // tasks below this one, not counting deleted ones
+  int    nopen;         // tasks below this one that are open, kept by list
+  int    id;            // parsed "id" field, kept in sync by taskSet
+  int    parent_id;     // parsed "parent_id" field, kept in sync by taskSet
+  int    status;        // "status" field as a taskStatus
+  unsigned flags  : 4;  // taskFlags indicating changes to the task
+  unsigned linked : 1;  // whether it's in the list's tree, kept by list
+  taskPool_T pool;      // pool holding the task, or NULL if allocated alone
+  arena_T    arena;     // arena holding the fields, or NULL if on the heap
 };
 
 typedef struct elem_T *elem_T;
 typedef struct task_T *task_T;
 
 extern task_T taskNew();
+
+/**
+ * A task pool allocates tasks in contiguous chunks, so that tasks loaded
+ * together sit together in memory. Tasks from a pool are released with
+ * taskFree as usual, which returns them to the pool for reuse. Freeing
+ * the pool releases every task allocated from it.
+ *
+ * If the pool is given an arena, the pool, its tasks and their fields are
+ * allocated from the arena and released along with it, and taskPoolFree
+ * doesn't need to be called.
+ */
+extern taskPool_T taskPoolNew(arena_T);
+extern task_T     taskPoolAlloc(taskPool_T);
+extern void       taskPoolFree(taskPool_T *);
 extern int    taskSize(const task_T); // TODO: rename this
 
 /**
  * Sets the value of given key, which can't be NULL. If the key already exists
  * then the memory help by val is first free, then it is set to the new value.
- * If val is NULL, the the value is set to "". For both the key and val,
- * the arguments are copied.
+ * If val is NULL, the the value is set to "". The key is interned as an atom
+ * and val is copied. Lookups are fastest when the key passed is an atom.
+ *
+ * Short values are held inside the task's fields, which move when a field
+ * is added past their length, or when the task is conformed or set into a
+ * list. Tasks from listNewTask already have a field for each of the list's
+ * keys, so their values stay put while those are set. Otherwise a value
+ * returned by taskGet is only valid until the next taskSet on the task.
  */
 extern void    taskSet(task_T, const char *key, const char *val);
 extern char   *taskGet(task_T, const char *key);
 
+/**
+ * Values of an interned key are stored as atoms, so each distinct value is
+ * held once however many tasks have it, and values can be compared with ==.
+ * This suits keys with few distinct values, like category or status.
+ * Tasks that already have the key keep their values until they're set again.
+ *
+ * The atoms are shared by every list rather than kept in a dictionary of
+ * codes for each list, so a field still takes a pointer rather than a
+ * small code, and values live until the program exits. Interning a key
+ * with many distinct values, like name, would hold every one of them.
+ * taskKeyIsInterned doesn't intern the key it's asked about.
+ */
+extern int     taskInternKey(const char *key);
+extern int     taskKeyIsInterned(const char *key);
+
+/**
+ * Slots are the positions of the fields in a task. When a task conforms to
+ * a list's keys, the value of keys[i] is held in slot i, so it can be
+ * fetched without searching by key.
+ */
+extern char   *taskGetSlot(const task_T, const int slot);
+
+/**
+ * Reorders the fields of the task so that keys[i] is held in slot i. Keys
+ * the task doesn't have are set to "", as addTask does for new tasks.
+ * Fields whose keys aren't in keys are kept after the last slot.
+ */
+extern int     taskConform(task_T, const char **keys, const int nkeys);
+
+/**
+ * Moves the fields of the task into arena, or onto the heap if arena is
+ * NULL, so that they're released along with it
+ */
+extern int     taskSetArena(task_T, arena_T);
+
 extern elem_T  taskElemInd(const task_T task, const int ind);
-extern char   *elemKey(const elem_T);
+
+/**
+ * If elem is NULL, returns the first field of the task. If elem is not
+ * null, then returns the next field, or NULL after the last one.
+ */
+extern elem_T  taskNextElem(const task_T, const elem_T);
+extern const char *elemKey(const elem_T);
 extern char   *elemVal(const elem_T);
 extern char   *taskValInd(const task_T task, const int ind);
-extern char   *taskKeyInd(const task_T task, const int ind);
+extern const char *taskKeyInd(const task_T task, const int ind);
 extern int     taskCheckKeys(const task_T);
 
 extern task_T  taskGetSubtask(const task_T);
 extern task_T  taskGetNext(const task_T);
 
+/**
+ * Returns whether task is ancestor or one of the tasks below it. Only
+ * the parents of task are visited, so it takes time linear to the depth
+ * of task, however large ancestor's subtree is
+ */
+extern bool    taskIsDescendant(const task_T task, const task_T ancestor);
+
 extern int     taskSetFlag(task_T, const int flags);
 extern int     taskUnsetFlag(task_T, const int flags);
 extern int     taskGetFlag(const task_T, const int flag);
 
+/**
+ * These return the parsed values of the "id", "parent_id" and "status"
+ * fields, so that comparing them doesn't require comparing strings
+ */
+extern int     taskGetId(const task_T);
+extern int     taskGetParentId(const task_T);
+extern int     taskGetStatus(const task_T);
+
 extern int     taskSetLevel(task_T, const int level);
+
+/**
+ * Returns the depth of task in its tree, 0 for a top-level task. It's
+ * counted up through the parents, so it's right even after a move.
+ */
 extern int     taskGetLevel(const task_T);
 
+/**
+ * These return the number of tasks below the task in its list, and how
+ * many of them are still open, i.e., neither complete nor deleted.
+ * The list keeps them up to date, so they don't walk the subtree.
+ */
+extern int     taskNumSubtasks(const task_T);
+extern int     taskNumOpenSubtasks(const task_T);
+
 extern int     taskSwap(task_T old, task_T new);
 extern void    taskFree(task_T *);
 
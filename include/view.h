@@ -23,8 +23,8 @@
 #ifndef TD_VIEW_INCLUDED
 #define TD_VIEW_INCLUDED
 
-#include "list.h" // list_T
+#include "session.h" // session_T
 
-extern void view(list_T, const char *filename);
+extern void view(session_T);
 
 #endif // TD_VIEW_INCLUDED
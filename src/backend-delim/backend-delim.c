@@ -20,8 +20,9 @@
 
 #include <stdio.h>           // fprintf
 #include <stdlib.h>          // NULL
-#include <string.h>          // strcasecmp
 #include "delim-reader.h"    // parseDelim
+#include "mem.h"             // memCalloc, memFree
+#include "atom.h"            // atomString
 #include "task.h"
 #include "list.h"
 #include "return-codes.h"
@@ -46,27 +47,36 @@ readTasks_delim(list_T list, const char *filename, const char sep)
   if (!data)
     errExit("Failed to parse delimited data");
 
-  for (int i=0; i < data->nfields; i++)
+  // Set fields by atom so taskSet doesn't have to intern the headers
+  const char *keys[data->nfields];
+  for (int i=0; i < data->nfields; i++) {
     listAddKey(list, data->headers->fields[i]);
+    keys[i] = atomString(data->headers->fields[i]);
+  }
+
+  task_T *tasks = memCalloc(data->nrecords + 1, sizeof(task_T));
+  if (!tasks)
+    errExit("Failed to allocate tasks");
 
   for (int i=0; i < data->nrecords; i++) {
-    task_T task = taskNew();
+    task_T task = listNewTask(list);
     if (!task)
       errExit("Failed to allocate new task");
 
     for (int j=0; j < data->nfields; j++)
-      taskSet(task, data->headers->fields[j], data->records[i]->fields[j]);
+      taskSet(task, keys[j], data->records[i]->fields[j]);
 
     if (taskCheckKeys(task) != TD_OK) 
       errExit("Task doesn't have all required keys");
 
+    // listBulkLoad counts these as updates
     taskSetFlag(task, TF_NEW|TF_UPDATE);
+    tasks[i] = task;
+  }
 
-    // TODO: remove this dependency on knowing the internal structure of list
-    list->nupdates++;
+  if (listBulkLoad(list, tasks, data->nrecords) != TD_OK)
+    errExit("Failed to load tasks");
 
-    if (strcasecmp(taskGet(task, "status"), "Complete") != 0)
-      listSetTask(list, task);
-  }
+  memFree(tasks);
 }
 
@@ -18,12 +18,15 @@
 // limitations under the License.
 //
 
-#include <stdio.h>           // fprintf
+#include <stdio.h>           // fprintf, vsnprintf
+#include <stdarg.h>          // va_list, va_start, va_end
 #include <stdlib.h>          // NULL
-#include <string.h>          // strlen, strcasecmp, strncpy
+#include <string.h>          // strlen, strcmp
 #include <stdbool.h>         // false
 #include <ctype.h>           // isalpha, isalnum
 #include <sqlite3.h>
+#include "mem.h"             // memCalloc, memResize, memFree
+#include "atom.h"            // atomString
 #include "task.h"
 #include "list.h"
 #include "backend-sqlite3.h"
@@ -61,22 +64,37 @@ isValidTableName(const char *tableName)
   return TD_OK;
 }
 
+/**
+ * Appends formatted text to buf at *pos and advances *pos. This lets
+ * statements be built in time linear to their length. Once buf overflows,
+ * nothing more is written and *pos is left at or past len.
+ */
+static void
+appendSQL(char *buf, const size_t len, size_t *pos, const char *fmt, ...)
+{
+  if (*pos >= len) return;
+
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vsnprintf(buf + *pos, len - *pos, fmt, ap);
+  va_end(ap);
+
+  *pos = n < 0 ? len : *pos + n;
+}
+
 // -----------------------------------------------------------------------------
 // Template
 // -----------------------------------------------------------------------------
 
+/**
+ * Runs a single statement on a database that's already open
+ */
 static int
-runSQL(const char *filename, list_T list, task_T task,
+execSQL(sqlite3 *db, list_T list, task_T task,
   int genSQL(const list_T, const task_T, char *, const size_t),
   int bindSQL(sqlite3_stmt *, sqlite3 *, const list_T, const task_T),
   int processSQL(sqlite3_stmt *, sqlite3 *, list_T, task_T))
 {
-  if (!list) return TD_INVALIDARG;
-
-  int rc = isValidTableName(listName(list));
-  if (rc != TD_OK) return rc;
-
-  sqlite3 *db;
   sqlite3_stmt *stmt;
 
   char sql[MAX_SQL_LEN];
@@ -84,17 +102,7 @@ runSQL(const char *filename, list_T list, task_T task,
   if (genSQL(list, task, sql, MAX_SQL_LEN) != TD_OK)
     return BE_ESQLGEN;
 
-  rc = sqlite3_open_v2(
-    filename,              // filename
-    &db,                   // db handle
-    SQLITE_OPEN_READWRITE, // don't create if database doesn't exist
-    NULL                   // OS interface for db connection
-  );
-
-  if (rc != SQLITE_OK) 
-    return BE_DBNOTEXIST;
-
-  rc = sqlite3_prepare_v2(
+  int rc = sqlite3_prepare_v2(
     db,                    // db handle
     sql,                   // sql statement
     strlen(sql)+1,         // maximum length of sql, in bytes (including '\0')
@@ -105,19 +113,59 @@ runSQL(const char *filename, list_T list, task_T task,
   if (rc != SQLITE_OK) 
     return BE_ESQLPREP;
 
-  if (bindSQL)
-    if (bindSQL(stmt, db, list, task) != TD_OK)
-      return BE_ESQLBIND;
+  if (bindSQL && bindSQL(stmt, db, list, task) != TD_OK)
+    rc = BE_ESQLBIND;
 
-  if (processSQL(stmt, db, list, task) != TD_OK)
-    return BE_ESQLPROC;
+  else if (processSQL(stmt, db, list, task) != TD_OK)
+    rc = BE_ESQLPROC;
+
+  else rc = TD_OK;
 
   sqlite3_finalize(stmt);
-  sqlite3_close(db);
+
+  return rc;
+}
+
+static int
+openDB(sqlite3 **db, const list_T list, const char *filename)
+{
+  if (!list) return TD_INVALIDARG;
+
+  int rc = isValidTableName(listName(list));
+  if (rc != TD_OK) return rc;
+
+  rc = sqlite3_open_v2(
+    filename,              // filename
+    db,                    // db handle
+    SQLITE_OPEN_READWRITE, // don't create if database doesn't exist
+    NULL                   // OS interface for db connection
+  );
+
+  if (rc != SQLITE_OK) {
+    sqlite3_close(*db);
+    return BE_DBNOTEXIST;
+  }
 
   return TD_OK;
 }
 
+static int
+runSQL(const char *filename, list_T list, task_T task,
+  int genSQL(const list_T, const task_T, char *, const size_t),
+  int bindSQL(sqlite3_stmt *, sqlite3 *, const list_T, const task_T),
+  int processSQL(sqlite3_stmt *, sqlite3 *, list_T, task_T))
+{
+  sqlite3 *db;
+
+  int rc = openDB(&db, list, filename);
+  if (rc != TD_OK) return rc;
+
+  rc = execSQL(db, list, task, genSQL, bindSQL, processSQL);
+  sqlite3_close(db);
+
+  return rc;
+}
+
 static int
 processNoResultSQL(sqlite3_stmt *stmt, sqlite3 *db, list_T list, task_T task)
 {
@@ -145,6 +193,39 @@ genReadSQL(const list_T list, const task_T unused, char *buf, const size_t len)
   return TD_OK;
 }
 
+// Siblings are linked ahead of the ones read before them, so reading
+// them in descending position puts them in order. Tasks without one
+// come first, newest first, as they did before there were positions
+static int
+genReadOrderedSQL(const list_T list, const task_T unused, char *buf, 
+  const size_t len)
+{
+  if (snprintf(buf, len, 
+    "select * from %s order by ifnull(position, '') desc, rowid", 
+    listName(list)) >= len)
+    return TD_BUFOVERFLOW;
+
+  return TD_OK;
+}
+
+/**
+ * Checks whether the table of list has column by preparing a query of it
+ */
+static int
+hasColumn(sqlite3 *db, const list_T list, const char *column)
+{
+  char sql[MAX_SQL_LEN];
+  if (snprintf(sql, MAX_SQL_LEN, "select %s from %s limit 0", 
+    column, listName(list)) >= MAX_SQL_LEN)
+    return false;
+
+  sqlite3_stmt *stmt;
+  int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+  sqlite3_finalize(stmt);
+
+  return rc == SQLITE_OK;
+}
+
 // TODO: check that parent_id / category combinations are valid
 // TODO: abstract the query portions
 static int
@@ -153,8 +234,19 @@ processReadSQL(sqlite3_stmt *stmt, sqlite3 *db, list_T list, task_T task)
   int rc;
   int ncols = sqlite3_column_count(stmt);
 
-  for (int i=0; i < ncols; i++)
+  // Set fields by atom so taskSet doesn't have to intern the column names
+  const char *keys[ncols];
+  for (int i=0; i < ncols; i++) {
     listAddKey(list, sqlite3_column_name(stmt, i));
+    keys[i] = atomString(sqlite3_column_name(stmt, i));
+  }
+
+  // All of the rows are read before any are added to the list,
+  // so that subtasks can come before their parents
+  int ntasks = 0, tasks_len = 1024;
+  task_T *tasks = memCalloc(tasks_len, sizeof(task_T));
+  if (!tasks)
+    sqlErr("Failed to allocate tasks");
 
   while ((rc = sqlite3_step(stmt)) != SQLITE_DONE) {
 
@@ -162,30 +254,46 @@ processReadSQL(sqlite3_stmt *stmt, sqlite3 *db, list_T list, task_T task)
       // TODO: return error code instead of exiting
       sqlErr("Unable to fetch tasks: %s", sqlite3_errmsg(db));
 
-    task_T task = taskNew();
+    if (ntasks >= tasks_len) {
+      tasks_len <<= 1;
+      if (!(tasks = memResize(tasks, tasks_len * sizeof(task_T))))
+        sqlErr("Failed to allocate tasks");
+    }
+
+    task_T task = listNewTask(list);
     if (task == NULL)
       sqlErr("Failed to allocate new task");
 
     for (int i=0; i<ncols; i++)
-      taskSet(task, sqlite3_column_name(stmt, i), 
-        (char *) sqlite3_column_text(stmt, i));
+      taskSet(task, keys[i], (char *) sqlite3_column_text(stmt, i));
 
-    if (taskCheckKeys(task) != TD_OK) 
+    if (taskCheckKeys(task) != TD_OK) {
+      memFree(tasks);
       return BE_ESQLPROC;
+    }
 
-    if (strcasecmp(taskGet(task, "status"), "Complete") != 0)
-      listSetTask(list, task);
-
+    tasks[ntasks++] = task;
   }
-  
-  return TD_OK;
+
+  rc = listBulkLoad(list, tasks, ntasks);
+  memFree(tasks);
+
+  return rc == TD_OK ? TD_OK : BE_ESQLPROC;
 }
 
 int
 readTasks(list_T list, const char *filename)
 {
-  return runSQL(filename, list, NULL, 
-    genReadSQL, NULL, processReadSQL);
+  sqlite3 *db;
+  int rc = openDB(&db, list, filename);
+  if (rc != TD_OK) return rc;
+
+  rc = execSQL(db, list, NULL, 
+    hasColumn(db, list, "position") ? genReadOrderedSQL : genReadSQL, 
+    NULL, processReadSQL);
+  sqlite3_close(db);
+
+  return rc;
 }
 
 // -----------------------------------------------------------------------------
@@ -203,6 +311,64 @@ backendCheck(const list_T list, const char *filename)
   return runSQL(filename, list, NULL, genReadSQL, NULL, processNoResultSQL);
 }
 
+// -----------------------------------------------------------------------------
+// List Names
+// -----------------------------------------------------------------------------
+
+int
+readListNames(const char *filename, const char ***names, int *nnames)
+{
+  if (!(filename && names && nnames)) return TD_INVALIDARG;
+
+  sqlite3 *db;
+  if (sqlite3_open_v2(filename, &db, SQLITE_OPEN_READONLY, NULL) != SQLITE_OK) {
+    sqlite3_close(db);
+    return BE_DBNOTEXIST;
+  }
+
+  const char *sql = 
+    "select name from sqlite_master where type = 'table' order by name";
+
+  sqlite3_stmt *stmt;
+  if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+    sqlite3_close(db);
+    return BE_ESQLPREP;
+  }
+
+  int n = 0, len = 16, rc = SQLITE_DONE;
+  const char **out = memCalloc(len, sizeof(char *));
+  while (out && (rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+    const char *name = (const char *) sqlite3_column_text(stmt, 0);
+
+    // Tables that couldn't have been made by backendCreate aren't lists
+    if (isValidTableName(name) != TD_OK) continue;
+
+    if (n >= len) {
+      len <<= 1;
+      const char **ptr = memResize(out, len * sizeof(char *));
+      if (!ptr) memFree(out);
+      out = ptr;
+      if (!out) break;
+    }
+
+    out[n++] = atomString(name);
+  }
+
+  sqlite3_finalize(stmt);
+  sqlite3_close(db);
+
+  if (!out) return TD_INVALIDARG; // TODO: return error code
+  if (rc != SQLITE_DONE) {
+    memFree(out);
+    return BE_ESQLPROC;
+  }
+
+  *names = out;
+  *nnames = n;
+
+  return TD_OK;
+}
+
 // -----------------------------------------------------------------------------
 // Update
 // -----------------------------------------------------------------------------
@@ -220,57 +386,43 @@ genUpdateSQL(const list_T list, const task_T task, char *buf, const size_t len)
 {
   if (!(buf && len)) return TD_INVALIDARG;
 
-  char tmp[len];
-
-  char *text = "update %s set ";
-  snprintf(buf, len, text, listName(list));
-
-  // snprintf will ensure there is a null-terminating byte with this len
-  strncpy(tmp, buf, len);
-
-  //      buf (comma) key = ?X
-  text = "%s%s%s=?%d";
-  char comma[2] = " ";
-  char *key;
-
-  int i;
-  for (i=0; i < taskSize(task); i++) {
-  
-    key = elemKey(taskElemInd(task, i));
-    if (strcmp(key, "id") == 0) continue;
-
-    snprintf(buf, len, text, tmp, comma, key, i+1);
-
-    strncpy(tmp, buf, len);
-    comma[0] = ',';
+  size_t pos = 0;
+  appendSQL(buf, len, &pos, "update %s set ", listName(list));
 
+  // Parameters are numbered by field position, skipping id
+  char *comma = "";
+  int i = 0;
+  elem_T elem = NULL;
+  while ((elem = taskNextElem(task, elem))) {
+    i++;
+    if (strcmp(elemKey(elem), "id") == 0) continue;
+    appendSQL(buf, len, &pos, "%s%s=?%d", comma, elemKey(elem), i);
+    comma = ",";
   }
 
-  text = "%s where id=?%d";
+  appendSQL(buf, len, &pos, " where id=?%d", i+1);
 
-  // Any of the above can cause an overflow, but
-  // because we concatenate the strings cumulatively,
-  // we only have to check the last one
-  if (snprintf(buf, len, text, tmp, i+1) >= len)
-    return TD_BUFOVERFLOW;
+  // Any of the above can cause an overflow, but appendSQL
+  // stops writing once it does, so we only check at the end
+  if (pos >= len) return TD_BUFOVERFLOW;
 
   return TD_OK;
-  
 }
 
 static int
 bindUpdateSQL(sqlite3_stmt *stmt, sqlite3 *db, const list_T list, const task_T task)
 {
-  int i;
-  elem_T elem;
-  for (i=0; i < taskSize(task); i++) {
-    elem = taskElemInd(task, i);
+  int i = 0;
+  elem_T elem = NULL;
+  while ((elem = taskNextElem(task, elem))) {
+    i++;
     if (strcmp(elemKey(elem), "id") == 0) continue;
-    if (sqlite3_bind_text(stmt, i+1, elemVal(elem), -1, SQLITE_STATIC) != SQLITE_OK)
+    if (sqlite3_bind_text(stmt, i, elemVal(elem), -1, SQLITE_STATIC) != SQLITE_OK)
       return BE_ESQLBIND;
   }
 
-  if (sqlite3_bind_text(stmt, i+1, taskGet(task, "id"), -1, SQLITE_STATIC) != SQLITE_OK)
+  if (sqlite3_bind_text(stmt, i+1, listTaskGet(list, task, LS_ID), -1, 
+    SQLITE_STATIC) != SQLITE_OK)
     return BE_ESQLBIND;
 
   return TD_OK;
@@ -299,58 +451,41 @@ genInsertSQL(const list_T list, const task_T task, char *buf, const size_t len)
 {
   if (!(buf && len)) return TD_INVALIDARG;
 
-  elem_T elem;
-  char tmp[len];
-
-  char *text = "insert into %s (";
-  snprintf(buf, len, text, listName(list));
-
-  // snprintf will ensure there is a null-terminating byte with this len
-  strncpy(tmp, buf, len);
-
-  char comma[2] = "";
-  char *key;
-
+  size_t pos = 0;
+  appendSQL(buf, len, &pos, "insert into %s (", listName(list));
 
   // Construct this part: id, parent_id, category, name, status, ...
-  int i;
-  for (i=0; i < taskSize(task); i++) {
-  
-    key = elemKey(taskElemInd(task, i));
-    snprintf(buf, len, "%s%s%s", tmp, comma, key);
-
-    strncpy(tmp, buf, len);
-    comma[0] = ',';
-
+  char *comma = "";
+  int i = 0;
+  elem_T elem = NULL;
+  while ((elem = taskNextElem(task, elem))) {
+    appendSQL(buf, len, &pos, "%s%s", comma, elemKey(elem));
+    comma = ",";
+    i++;
   }
 
-  text = "%s) values (";
-  snprintf(buf, len, text, tmp);
-  strncpy(tmp, buf, len);
+  appendSQL(buf, len, &pos, ") values (");
 
-// Construct this part: ?1, ?2, ?3, ?4, ?5, ...
-  comma[0] = ' ';
-  for (int j=0; j<i; j++) {
-    snprintf(buf, len, "%s%s?%d", tmp, comma, j+1);
-    strncpy(tmp, buf, len);
-    comma[0] = ',';
-  }
+  // Construct this part: ?1, ?2, ?3, ?4, ?5, ...
+  for (int j=0; j<i; j++)
+    appendSQL(buf, len, &pos, j ? ",?%d" : "?%d", j+1);
 
-  // Any of the above can cause an overflow, but
-  // because we concatenate the strings cumulatively,
-  // we only have to check the last one
-  if (snprintf(buf, len, "%s)", tmp) >= len)
-    return TD_BUFOVERFLOW;
+  appendSQL(buf, len, &pos, ")");
+
+  // Any of the above can cause an overflow, but appendSQL
+  // stops writing once it does, so we only check at the end
+  if (pos >= len) return TD_BUFOVERFLOW;
 
   return TD_OK;
-  
 }
 
 static int
 bindInsertSQL(sqlite3_stmt *stmt, sqlite3 *db, const list_T list, const task_T task)
 {
-  for (int i=0; i < taskSize(task); i++)
-    sqlite3_bind_text(stmt, i+1, taskValInd(task, i), -1, SQLITE_STATIC);
+  int i = 0;
+  elem_T elem = NULL;
+  while ((elem = taskNextElem(task, elem)))
+    sqlite3_bind_text(stmt, ++i, elemVal(elem), -1, SQLITE_STATIC);
 
   return TD_OK;
 }
@@ -378,19 +513,13 @@ genDeleteSQL(const list_T list, const task_T unused, char *buf, const size_t len
 static int
 bindDeleteSQL(sqlite3_stmt *stmt, sqlite3 *db, const list_T list, const task_T task)
 {
-  if (sqlite3_bind_text(stmt, 1, taskGet(task, "id"), -1, SQLITE_STATIC) != SQLITE_OK)
+  if (sqlite3_bind_text(stmt, 1, listTaskGet(list, task, LS_ID), -1, 
+    SQLITE_STATIC) != SQLITE_OK)
     return BE_ESQLBIND;
 
   return TD_OK;
 }
 
-static int
-deleteTask(list_T list, task_T task, const char *filename)
-{
-  return runSQL(filename, list, task, 
-    genDeleteSQL, bindDeleteSQL, processNoResultSQL);
-}
-
 int
 writeUpdates(list_T list, const char *filename)
 {
@@ -399,19 +528,49 @@ writeUpdates(list_T list, const char *filename)
   if (!updates)
     errExit("Failed to write updates: null pointer passed as argument"); 
 
-  // TODO: if there is an error, this will do a partial write.
-  // See if we can rollback if there's an error.
-  for (int i=0; updates[i]; i++) {
-    // TODO: check return code for each of these operations
-    if (taskGetFlag(updates[i], TF_NEW)) writeNewTask(list, updates[i], filename);
-    else if (taskGetFlag(updates[i], TF_DELETE)) deleteTask(list, updates[i], filename);
-    else updateTask(list, updates[i], filename);
+  sqlite3 *db;
+  int rc = openDB(&db, list, filename);
+  if (rc != TD_OK) {
+    free(updates);
+    return rc;
+  }
+
+  // The updates are written over one connection in a single transaction,
+  // so a save is either written in full or rolled back
+  if (sqlite3_exec(db, "begin", NULL, NULL, NULL) != SQLITE_OK)
+    rc = BE_ESQLPROC;
+
+  for (int i=0; rc == TD_OK && updates[i]; i++) {
+    // A new task that was deleted before it was saved has nothing to write
+    if (taskGetFlag(updates[i], TF_NEW) && taskGetFlag(updates[i], TF_DELETE))
+      continue;
+
+    if (taskGetFlag(updates[i], TF_NEW)) 
+      rc = execSQL(db, list, updates[i], 
+        genInsertSQL, bindInsertSQL, processNoResultSQL);
+    else if (taskGetFlag(updates[i], TF_DELETE)) 
+      rc = execSQL(db, list, updates[i], 
+        genDeleteSQL, bindDeleteSQL, processNoResultSQL);
+    else 
+      rc = execSQL(db, list, updates[i], 
+        genUpdateSQL, bindUpdateSQL, processNoResultSQL);
   }
 
+  if (rc == TD_OK && sqlite3_exec(db, "commit", NULL, NULL, NULL) != SQLITE_OK)
+    rc = BE_ESQLPROC;
+
+  if (rc != TD_OK) sqlite3_exec(db, "rollback", NULL, NULL, NULL);
+
+  sqlite3_close(db);
   free(updates);
-  listClearUpdates(list);
 
-  return TD_OK;
+  // Once saved, completed and deleted tasks no longer need to be kept
+  if (rc == TD_OK) {
+    listClearUpdates(list);
+    listCompact(list);
+  }
+
+  return rc;
 }
 
 // -----------------------------------------------------------------------------
@@ -423,40 +582,31 @@ genCreateSQL(const list_T list, const task_T unused, char *buf, const size_t len
 {
   if (!(buf && len)) return TD_INVALIDARG;
 
-  elem_T elem;
-  char tmp[len];
+  size_t pos = 0;
+  appendSQL(buf, len, &pos, "create table %s (", listName(list));
 
-  char *text ="create table %s (";
-  // snprintf will ensure there is a null-terminating byte with this len
-  snprintf(buf, len, text, listName(list));
-  strncpy(tmp, buf, len);
-
-  // format: "tmp (comma) col (extra-args)"
-  text = "%s %s %s text %s";
+  // format: "(comma) col text (extra-args)"
   char *extra_args;
-  char comma[2] = "";
-  char **keys = listGetKeys(list);
+  char *comma = "";
+  const char **keys = listGetKeys(list);
 
   for (int i=0; i < listNumKeys(list); i++) {
     if (strcmp(keys[i], "id") == 0)
-      extra_args = "primary key";
+      extra_args = " primary key";
     else if (strcmp(keys[i], "name") == 0)
-      extra_args = "not null";
+      extra_args = " not null";
     else
       extra_args = "";
 
-    snprintf(buf, len, text, tmp, comma, keys[i], extra_args);
-    strncpy(tmp, buf, len);
-    comma[0] = ',';
+    appendSQL(buf, len, &pos, "%s%s text%s", comma, keys[i], extra_args);
+    comma = ", ";
   }
 
-  text = "%s)";
+  appendSQL(buf, len, &pos, ")");
 
-  // Any of the above can cause an overflow, but
-  // because we concatenate the strings cumulatively,
-  // we only have to check the last one
-  if (snprintf(buf, len, text, tmp) >= len)
-    return TD_BUFOVERFLOW;
+  // Any of the above can cause an overflow, but appendSQL
+  // stops writing once it does, so we only check at the end
+  if (pos >= len) return TD_BUFOVERFLOW;
 
   return TD_OK;
 }
@@ -0,0 +1,137 @@
+//
+// -----------------------------------------------------------------------------
+// atom.c
+// -----------------------------------------------------------------------------
+//
+// Copyright (c) 2022 Tyler Wayne
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <string.h> // memcpy, memcmp, strlen
+#include "mem.h"    // memAlloc, memCalloc, memFree
+#include "atom.h"
+
+struct atom {
+  struct atom *link; // next atom in the bucket
+  int len;           // length of str, not including the '\0'
+  char str[];
+};
+
+static struct atom **buckets = NULL;
+static int nbuckets = 0;
+static int natoms = 0;
+
+// FNV-1a
+static unsigned
+hash(const char *str, const int len)
+{
+  unsigned h = 2166136261u;
+  for (int i=0; i < len; i++) {
+    h ^= (unsigned char) str[i];
+    h *= 16777619u;
+  }
+  return h;
+}
+
+/**
+ * Doubles the number of buckets once there are twice as many atoms
+ * as buckets, so that the chains stay short
+ */
+static int
+atomGrow()
+{
+  int len = nbuckets ? nbuckets << 1 : 256;
+  struct atom **grown = memCalloc(len, sizeof(*grown));
+  if (!grown) return -1;
+
+  for (int i=0; i < nbuckets; i++) {
+    struct atom *p, *link;
+    for (p=buckets[i]; p; p=link) {
+      link = p->link;
+      unsigned h = hash(p->str, p->len) & (len - 1);
+      p->link = grown[h];
+      grown[h] = p;
+    }
+  }
+
+  memFree(buckets);
+  buckets = grown;
+  nbuckets = len;
+
+  return 0;
+}
+
+const char *
+atomNew(const char *str, const int len)
+{
+  if (!str || len < 0) return NULL;
+
+  if (natoms >= nbuckets << 1 && atomGrow() != 0)
+    return NULL;
+
+  unsigned h = hash(str, len) & (nbuckets - 1);
+
+  struct atom *p;
+  for (p=buckets[h]; p; p=p->link)
+    if (p->len == len && memcmp(p->str, str, len) == 0)
+      return p->str;
+
+  p = memAlloc(sizeof(*p) + len + 1);
+  if (!p) return NULL;
+
+  p->len = len;
+  memcpy(p->str, str, len);
+  p->str[len] = '\0';
+
+  p->link = buckets[h];
+  buckets[h] = p;
+  natoms++;
+
+  return p->str;
+}
+
+const char *
+atomString(const char *str)
+{
+  if (!str) return NULL;
+  return atomNew(str, strlen(str));
+}
+
+const char *
+atomFind(const char *str)
+{
+  if (!(str && buckets)) return NULL;
+
+  int len = strlen(str);
+  unsigned h = hash(str, len) & (nbuckets - 1);
+
+  for (struct atom *p=buckets[h]; p; p=p->link)
+    if (p->len == len && memcmp(p->str, str, len) == 0) return p->str;
+
+  return NULL;
+}
+
+int
+atomLength(const char *atom)
+{
+  if (!atom) return -1;
+
+  int len = strlen(atom);
+  unsigned h = hash(atom, len) & (nbuckets - 1);
+
+  for (struct atom *p=buckets ? buckets[h] : NULL; p; p=p->link)
+    if (p->str == atom) return p->len;
+
+  return -1;
+}
@@ -20,12 +20,13 @@
 
 #include <stdio.h>  // printf
 #include <stdlib.h> // calloc, realloc, free
-#include <string.h> // strdup, strcmp
+#include <string.h> // strdup
+#include "atom.h"   // atomString
 #include "dict.h"
 
 // TODO: change dict to accept other data types
 struct elem_T {
-  char *key;
+  const char *key; // atom, see atom.h
   char *val;
   struct elem_T *link;
 };
@@ -39,8 +40,8 @@ elemFree(struct elem_T **elem)
 {
   if (!(elem && *elem)) return;
 
-  // key and val should never be NULL but we guard against it
-  if ((*elem)->key) free((*elem)->key);
+  // val should never be NULL but we guard against it.
+  // The key is an atom, which is never freed
   if ((*elem)->val) free((*elem)->val);
 
   free(*elem);
@@ -62,7 +63,7 @@ dictAddElem(dict_T dict, const char *key, const char *val)
   elem = calloc(1, sizeof(*elem));
   if (!elem) return DT_EALLOC;
 
-  elem->key = strdup(key);
+  elem->key = key;
   elem->val = strdup(val);
   elem->link = dict->head;
   dict->head = elem;
@@ -77,10 +78,13 @@ dictSet(dict_T dict, const char *key, const char *val)
   if (!(dict && key)) return DT_EINVALARG;
   if (!val) val = "";
 
+  key = atomString(key);
+  if (!key) return DT_EALLOC;
+
   struct elem_T *elem = dict->head;
 
   for ( ; elem ; elem = elem->link) {
-    if (strcmp(elem->key, key) == 0) {
+    if (elem->key == key) {
       free(elem->val);
       elem->val = strdup(val);
       return DT_OK;
@@ -95,10 +99,12 @@ dictGet(const dict_T dict, const char *key)
 {
   if (!(dict && key)) return NULL;
 
+  key = atomString(key);
+
   struct elem_T *elem = dict->head;
 
   for ( ; elem ; elem = elem->link )
-    if (strcmp(elem->key, key) == 0)
+    if (elem->key == key)
       return elem->val;
 
   return NULL;
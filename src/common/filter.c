@@ -0,0 +1,211 @@
+//
+// -----------------------------------------------------------------------------
+// filter.c
+// -----------------------------------------------------------------------------
+//
+// Copyright (c) 2022 Tyler Wayne
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <string.h>       // strlen, strcmp, strncmp, strchr, strspn, strcspn
+#include "mem.h"          // memCalloc, memFree
+#include "atom.h"         // atomNew, atomString, atomLength
+#include "filter.h"
+
+enum filterOps {
+  FO_EQ = 1,
+  FO_NE = 2,
+  FO_LT = 3,
+  FO_LE = 4,
+  FO_GT = 5,
+  FO_GE = 6
+};
+
+// Operators that start with another are listed before it
+static const struct {
+  const char *str;
+  int         op;
+} filter_ops[] = {
+  { "!=", FO_NE },
+  { "<=", FO_LE },
+  { ">=", FO_GE },
+  { "=",  FO_EQ },
+  { "<",  FO_LT },
+  { ">",  FO_GT },
+  { NULL, 0 }
+};
+
+struct filterTerm {
+  const char *key; // an atom
+  int         op;
+  const char *val; // an atom
+};
+
+struct filter_T {
+  struct filterTerm *terms;
+  int                nterms;
+};
+
+#define KEY_CHARS "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_"
+#define SPACE_CHARS " \t"
+
+/**
+ * Parses the term at the start of str, returning where it ends or NULL
+ * if it isn't a term
+ */
+static const char *
+parseTerm(struct filterTerm *term, const char *str)
+{
+  size_t len = strspn(str, KEY_CHARS);
+  if (len == 0) return NULL;
+
+  term->key = atomNew(str, len);
+  str += len;
+
+  int i;
+  for (i=0; filter_ops[i].str; i++) {
+    len = strlen(filter_ops[i].str);
+    if (strncmp(str, filter_ops[i].str, len) == 0) break;
+  }
+  if (!filter_ops[i].str) return NULL;
+
+  term->op = filter_ops[i].op;
+  str += len;
+
+  if (*str == '\'') {
+    const char *end = strchr(++str, '\'');
+    if (!end) return NULL;
+
+    term->val = atomNew(str, end - str);
+    str = end + 1;
+  } else {
+    len = strcspn(str, SPACE_CHARS);
+    term->val = atomNew(str, len);
+    str += len;
+  }
+
+  // A term ends at a space or the end of the query
+  if (*str && !strchr(SPACE_CHARS, *str)) return NULL;
+
+  return term->key && term->val ? str : NULL;
+}
+
+filter_T
+filterNew(const char *query)
+{
+  if (!query) return NULL;
+
+  filter_T filter = memCalloc(1, sizeof(*filter));
+  if (!filter) return NULL;
+
+  // Each term takes at least two characters and a space
+  filter->terms = memCalloc(strlen(query) / 2 + 1, sizeof(*filter->terms));
+  if (!filter->terms) {
+    memFree(filter);
+    return NULL;
+  }
+
+  const char *str = query + strspn(query, SPACE_CHARS);
+  while (str && *str) {
+    str = parseTerm(&filter->terms[filter->nterms++], str);
+    if (str) str += strspn(str, SPACE_CHARS);
+  }
+
+  if (!str || filter->nterms == 0) filterFree(&filter);
+
+  return filter;
+}
+
+int
+filterHasKey(const filter_T filter, const char *key)
+{
+  if (!(filter && key)) return 0;
+
+  key = atomString(key);
+  for (int i=0; i < filter->nterms; i++)
+    if (filter->terms[i].key == key) return 1;
+
+  return 0;
+}
+
+static int
+termEquals(const struct filterTerm *term, const char *val)
+{
+  static const char *category;
+  if (!category) category = atomString("category");
+
+  if (strcmp(val, term->val) == 0) return 1;
+  if (term->key != category) return 0;
+
+  int len = atomLength(term->val);
+  return strncmp(val, term->val, len) == 0 && val[len] == '/';
+}
+
+static int
+termMatch(const struct filterTerm *term, const char *val)
+{
+  switch (term->op) {
+  case FO_EQ: return termEquals(term, val);
+  case FO_NE: return !termEquals(term, val);
+  case FO_LT: return strcmp(val, term->val) < 0;
+  case FO_LE: return strcmp(val, term->val) <= 0;
+  case FO_GT: return strcmp(val, term->val) > 0;
+  case FO_GE: return strcmp(val, term->val) >= 0;
+  default:    return 0;
+  }
+}
+
+int
+filterMatch(const filter_T filter, task_T task)
+{
+  if (!(filter && task)) return 0;
+
+  for (int i=0; i < filter->nterms; i++) {
+    const char *val = taskGet(task, filter->terms[i].key);
+    if (!termMatch(&filter->terms[i], val ? val : "")) return 0;
+  }
+
+  return 1;
+}
+
+int
+filterNumTerms(const filter_T filter)
+{
+  if (!filter) return 0;
+  else return filter->nterms;
+}
+
+const char *
+filterTermKey(const filter_T filter, const int term)
+{
+  if (!filter || term < 0 || term >= filter->nterms) return NULL;
+  else return filter->terms[term].key;
+}
+
+int
+filterTermMatch(const filter_T filter, const int term, const char *val)
+{
+  if (!filter || term < 0 || term >= filter->nterms) return 0;
+  else return termMatch(&filter->terms[term], val ? val : "");
+}
+
+void
+filterFree(filter_T *filter)
+{
+  if (!(filter && *filter)) return;
+
+  memFree((*filter)->terms);
+  memFree(*filter);
+  *filter = NULL;
+}
@@ -18,28 +18,53 @@
 // limitations under the License.
 //
 
-#include <stdlib.h>       // free
-#include <string.h>       // strcmp, strdup
+#include <stdio.h>        // snprintf
+#include <stdint.h>       // uintptr_t
+#include <stdlib.h>       // free, qsort
+#include <string.h>       // strcmp, strcpy, strrchr, strdup, memmove, memset
 #include "return-codes.h" // TD_OK
-#include "mem.h"          // memCalloc, memResize
+#include "mem.h"          // memAlloc, memCalloc, memResize, memFree, arenaNew
+#include "atom.h"         // atomString, atomNew
+#include "position.h"     // positionBetween, positionIsValid
+#include "filter.h"       // filterNew, filterMatch, filterTermMatch
 #include "task.h"
 #include "list.h"
 
-// TODO: decouple this from catGetTask and move back to task.c
+static char *slot_keys[LS_NSLOTS] = {
+  [LS_ID]       = "id",
+  [LS_PARENTID] = "parent_id",
+  [LS_CATEGORY] = "category",
+  [LS_STATUS]   = "status",
+  [LS_POSITION] = "position"
+};
+
+char *
+listTaskGet(const list_T list, const task_T task, const int ind)
+{
+  int slot = list->slots[ind];
+  if (slot < 0) return taskGet(task, slot_keys[ind]);
+  else return taskGetSlot(task, slot);
+}
+
+// TODO: move back to task.c
 task_T
-taskFindChildById(const task_T task, const char *id)
+taskFindChildById(const task_T task, const int id)
 {
-  if (!(task && task->child && id)) return NULL;
-  task_T child = task->child;
-  do {
-    if (strcmp(taskGet(child, "id"), id) == 0)
-      return child;
-  } while ((child = catGetTask(NULL, child)));
+  if (!(task && task->child && id != TASK_NOID)) return NULL;
+
+  // Walk each child's subtree, so the search stays below task
+  struct taskIter it;
+  for (task_T child=task->child; child; child=child->rlink) {
+    taskIterInit(&it, child);
+    task_T sub;
+    while ((sub = taskIterNext(&it)))
+      if (sub->id == id) return sub;
+  }
 
   return NULL;
 }
 
-char *
+const char *
 catName(const cat_T cat)
 {
   if (!cat) return NULL;
@@ -71,433 +96,2612 @@ catGetTask(const cat_T cat, task_T task)
   return NULL;
 }
 
-static void
-catFreeTasks(task_T *task)
+void
+catIterInit(struct taskIter *it, const cat_T cat)
 {
-  if (!(task && *task)) return;
-
-  catFreeTasks(&(*task)->rlink);
-  catFreeTasks(&(*task)->child);
+  *it = (struct taskIter) { .first = cat ? cat->tasks : NULL, .depth = -1 };
+}
 
-  taskFree(task);
-  *task = NULL;
+void
+taskIterInit(struct taskIter *it, const task_T root)
+{
+  *it = (struct taskIter) { .root = root, .first = root, .depth = -1 };
 }
 
-/**
- * listGetCategory either fetches the category
- * matching the argument or creates the category,
- * if it doesn't exist, then returns it.
- */
-static cat_T
-getCategory(list_T list, char *name)
+task_T
+taskIterNext(struct taskIter *it)
 {
-  cat_T cat = NULL;
+  task_T task = it->task;
 
-  for (cat=list->cat; cat; cat=cat->link)
-    if (strcmp(cat->name, name) == 0) return cat;
+  if (it->depth < 0) {
+    it->depth = 0;
+    return it->task = it->first;
+  }
 
-  cat = memCalloc(1, sizeof(*cat));
-  if (!cat) return NULL; 
+  if (!task) return NULL;
 
-  cat->name = strdup(name);
-  cat->link = list->cat;
-  list->cat = cat;
-  list->ncats++;
+  if (task->child && !it->skip) {
+    it->depth++;
+    return it->task = task->child;
+  }
 
-  return cat;
-}
+  it->skip = 0;
 
-static task_T
-catFindTaskById(const cat_T cat, const char *id)
-{
-  if (!(cat && id)) return NULL;
-  task_T task = NULL;
-  while ((task = catGetTask(cat, task)))
-    if (strcmp(taskGet(task, "id"), id) == 0)
-      return task;
+  // Climb until there's a next sibling, without leaving root
+  for ( ; task && task != it->root; task=task->parent, it->depth--)
+    if (task->rlink) return it->task = task->rlink;
 
-  return NULL;
+  return it->task = NULL;
 }
 
-int
-catNumOpen(const cat_T cat)
+void
+taskIterSkip(struct taskIter *it)
 {
-  if (!cat) return 0;
-  return cat->nopen;
+  it->skip = 1;
 }
 
 // -----------------------------------------------------------------------------
-// List
+// Category index
 // -----------------------------------------------------------------------------
 
-list_T
-listNew(const char *name)
+/**
+ * Categories are indexed by name in a hash table with linear probing,
+ * laid out like the id index below. Names are atoms, so they're hashed
+ * and compared by address.
+ */
+static unsigned
+catHash(const char *name, const int len)
 {
-  list_T list;
-  list = memCalloc(1, sizeof(*list));
-  if (!list) return NULL;
-
-  list->name = strdup(name);
-
-  list->keys_len = 8;
-  list->keys = memCalloc(8, sizeof(char *));
-  if (!list->keys) {
-    free(list);
-    return NULL;
-  }
-
-  return list;
+  return ((unsigned) ((uintptr_t) name >> 4) * 2654435769u) & (len - 1);
 }
 
-void
-listFree(list_T *list)
+static cat_T
+catIndexGet(const list_T list, const char *name)
 {
-  if (!(list && *list)) return;
-
-  cat_T cat, next;
-
-  for (cat = (*list)->cat; cat; ) {
-    next = cat->link;
-    catFreeTasks(&cat->tasks);
-    free(cat->name);
-    cat = next;
-  }
-
-  for (int i=0; i<(*list)->nkeys; i++)
-    free((*list)->keys[i]);
-
-  free((*list)->keys);
-  free((*list)->name);
-
-  *list = NULL;
-}
+  if (!list->cat_index_len) return NULL;
 
-task_T
-listFindTaskById(const list_T list, const char *id)
-{
-  if (!(list && id)) return NULL;
+  unsigned mask = list->cat_index_len - 1;
+  unsigned i = catHash(name, list->cat_index_len);
 
-  cat_T cat = NULL;
-  while ((cat = listGetCat(list, cat))) {
-    task_T task = catFindTaskById(cat, id);
-    if (task) return task;
-  }
+  for ( ; list->cat_index[i]; i = (i + 1) & mask)
+    if (list->cat_index[i]->name == name) return list->cat_index[i];
 
   return NULL;
 }
 
-/**
- * This deletes the category and relinks the list.
- * It doesn't free the memory held by any tasks in
- * the category
- */
 static int
-listDeleteCat(list_T list, cat_T *cat)
+catIndexPut(list_T list, const cat_T cat)
 {
-  if (!(list && cat && *cat)) return TD_INVALIDARG;
+  // ncats already counts cat
+  if (2 * list->ncats > list->cat_index_len) {
+    int len = list->cat_index_len ? list->cat_index_len << 1 : 64;
+    cat_T *index = memCalloc(len, sizeof(cat_T));
+    if (!index) return -1; // TODO: return error code
+
+    for (int i=0; i < list->cat_index_len; i++) {
+      if (!list->cat_index[i]) continue;
+      unsigned j = catHash(list->cat_index[i]->name, len);
+      while (index[j]) j = (j + 1) & (len - 1);
+      index[j] = list->cat_index[i];
+    }
 
-  if (list->cat == *cat) list->cat = (*cat)->link;
-  else {
-    cat_T prev = list->cat;
-    for ( ; prev->link == (*cat); prev=prev->link ) ;
-    prev->link = (*cat)->link;
+    memFree(list->cat_index);
+    list->cat_index = index;
+    list->cat_index_len = len;
   }
 
-  free((*cat)->name);
-  free(*cat);
-  *cat = NULL;
+  unsigned mask = list->cat_index_len - 1;
+  unsigned i = catHash(cat->name, list->cat_index_len);
+  while (list->cat_index[i]) i = (i + 1) & mask;
+  list->cat_index[i] = cat;
 
   return TD_OK;
 }
 
-static int
-taskNumChildren(task_T task)
+static void
+catIndexRemove(list_T list, const cat_T cat)
 {
-  int n = 0;
-  if (!task) return 0;
-
-  int stop = task->level;
-  while ((task = catGetTask(NULL, task)) && task->level > stop) 
-    n++;
+  if (!list->cat_index_len) return;
 
-  return n;
-}
+  unsigned mask = list->cat_index_len - 1;
+  unsigned i = catHash(cat->name, list->cat_index_len);
 
-static int
-taskNumChildrenOpen(task_T task)
-{
-  int n = 0;
-  if (!task) return 0;
+  for ( ; list->cat_index[i] != cat; i = (i + 1) & mask)
+    if (!list->cat_index[i]) return;
 
-  int stop = task->level;
-  while ((task = catGetTask(NULL, task)) && task->level > stop)
-    if (!taskGetFlag(task, TF_COMPLETE)) n++;
+  list->cat_index[i] = NULL;
 
-  return n;
+  // Move back any entry that can no longer be reached across the gap
+  // at i, i.e., whose home slot k isn't cyclically in (i, j]
+  for (unsigned j = (i + 1) & mask; list->cat_index[j]; j = (j + 1) & mask) {
+    unsigned k = catHash(list->cat_index[j]->name, list->cat_index_len);
+    if (((j - k) & mask) >= ((j - i) & mask)) {
+      list->cat_index[i] = list->cat_index[j];
+      list->cat_index[j] = NULL;
+      i = j;
+    }
+  }
 }
 
-static int
-listPopTask(list_T list, task_T task)
+/**
+ * listGetCategory either fetches the category
+ * matching the argument or creates the category,
+ * if it doesn't exist, then returns it. Category names are
+ * atoms, so when the category key is interned (see taskInternKey)
+ * the name is matched without hashing it.
+ *
+ * Categories are linked in alphabetical order, so they're listed
+ * the same way regardless of the order they were loaded in.
+ */
+static cat_T
+getCategory(list_T list, const char *name)
 {
-  if (!(list && task)) return TD_INVALIDARG;
+  cat_T cat = catIndexGet(list, name);
+  if (cat) return cat;
 
-  cat_T cat = getCategory(list, taskGet(task, "category"));
+  const char *atom = atomString(name);
+  if (!atom) return NULL;
 
-  // If we're the only task in the category,
-  // then there isn't a parent.
-  if (cat->ntasks == 0) listDeleteCat(list, &cat);
+  if (atom != name && (cat = catIndexGet(list, atom))) return cat;
 
-  // If we're the first task in category,
-  // then there isn't a parent
-  else if (cat->tasks == task) cat->tasks = task->rlink;
+  cat = arenaCalloc(list->arena, 1, sizeof(*cat));
+  if (!cat) return NULL; 
 
-  // Otherwise, check if we're the first child of a parent
-  else if (task->parent) {
-    if (task->parent->child == task) 
-      task->parent->child = task->rlink;
+  cat->name = cat->label = atom;
+
+  // Nested in the category named by everything before the last '/'
+  const char *slash = strrchr(atom, '/');
+  if (slash && slash > atom && slash[1]) {
+    const char *parent = atomNew(atom, slash - atom);
+    if (!parent || !(cat->parent = getCategory(list, parent))) return NULL;
+    cat->label = slash + 1;
   }
-      
-  // If none of these, then there is a left link to adjust
-  else if (task->llink) task->llink->rlink = task->rlink;
 
-  if (task->rlink) task->rlink->llink = task->llink;
+  cat_T *sibling = cat->parent ? &cat->parent->child : &list->cat_tree;
+  while (*sibling && strcmp((*sibling)->name, atom) < 0)
+    sibling = &(*sibling)->sibling;
+  cat->sibling = *sibling;
+  *sibling = cat;
 
-  // Sever the task from the tree
-  task->parent = task->llink = task->rlink = NULL;
+  cat_T *link = &list->cat;
+  while (*link && strcmp((*link)->name, atom) < 0) link = &(*link)->link;
+  cat->link = *link;
+  *link = cat;
+  list->ncats++;
 
-  // Update accounting for ntasks and nopen
-  list->ntasks--;
-  cat->ntasks -= taskNumChildren(task) + 1;
-  cat->nopen -= taskNumChildrenOpen(task) + !taskGetFlag(task, TF_COMPLETE);
+  if (catIndexPut(list, cat) != TD_OK) return NULL;
 
-  return TD_OK;
+  return cat;
 }
 
-static void
-taskAdjustSubtreeLevels(task_T task, const int level)
+// -----------------------------------------------------------------------------
+// Id index
+// -----------------------------------------------------------------------------
+
+/**
+ * Tasks are indexed by id in a hash table with linear probing. The
+ * table is kept at most half full, and removals shift entries back
+ * into the gap so that there's no need for tombstones. Saved views
+ * keep their tasks in tables of their own, hashed by address so that
+ * tasks without ids can be held too.
+ */
+static unsigned
+idHash(const int id, const int len)
 {
-  if (!task) return;
-  
-  task->level = level;
-  if (task->child) taskAdjustSubtreeLevels(task->child, level + 1);
-  if (task->rlink) taskAdjustSubtreeLevels(task->rlink, level);
+  // Multiplying by an odd constant spreads consecutive ids apart
+  return ((unsigned) id * 2654435769u) & (len - 1);
 }
 
-int
-listSetTask(list_T list, task_T task)
+static unsigned
+idIndexHash(const struct taskIndex *index, const task_T task, const int len)
 {
-  // First check if the task current exists
-  task_T old = listFindTaskById(list, taskGet(task, "id"));
-  if (old) {
-    int new_placement = strcmp(taskGet(old, "parent_id"), 
-      taskGet(task, "parent_id")) || strcmp(taskGet(old, "category"),
-      taskGet(task, "category"));
+  if (!index->by_task) return idHash(task->id, len);
 
-    if (new_placement) listPopTask(list, old); // TODO: check for error
+  // Tasks from a pool are next to each other, so the low bits are mixed
+  // into the high ones
+  uint64_t addr = (uintptr_t) task;
+  return (unsigned) ((addr * 0x9e3779b97f4a7c15u) >> 32) & (len - 1);
+}
 
-    list->nupdates += !(old->flags & TF_UPDATE);
-    taskSwap(old, task);
-    task = old;
+static int
+idIndexGrow(struct taskIndex *index)
+{
+  int len = index->len ? index->len << 1 : 1024;
+  task_T *tasks = memCalloc(len, sizeof(task_T));
+  if (!tasks) return -1; // TODO: return error code
 
-    // If we have to adjust the placement of the task,
-    // then we let it fall through to the next section
-    if (!(new_placement)) return TD_OK;
+  for (int i=0; i < index->len; i++) {
+    task_T task = index->tasks[i];
+    if (!task) continue;
+
+    unsigned j = idIndexHash(index, task, len);
+    while (tasks[j]) j = (j + 1) & (len - 1);
+    tasks[j] = task;
   }
 
-  // If it doesn't check for an existing parent
-  cat_T cat = getCategory(list, taskGet(task, "category"));
-  task_T parent = listFindTaskById(list, taskGet(task, "parent_id"));
+  memFree(index->tasks);
+  index->tasks = tasks;
+  index->len = len;
 
-  if (parent) {
-    if (parent->child) parent->child->llink = task;
-    task->rlink = parent->child;
-    task->llink = NULL;
-    parent->child = task;
-    taskAdjustSubtreeLevels(task, parent->level+1);
-    task->parent = parent;
+  return TD_OK;
+}
 
-  // Otherwise, set as a new task
-  } else {
-    if (cat->tasks) cat->tasks->llink = task;
-    task->rlink = cat->tasks;
-    task->llink = NULL;
-    cat->tasks = task;
-    taskAdjustSubtreeLevels(task, 0);
-  }
+static int
+idIndexPut(struct taskIndex *index, const task_T task)
+{
+  if (!index->by_task && task->id == TASK_NOID) return TD_OK;
 
-  int id = strtol(taskGet(task, "id"), NULL, 10);
-  if (id > list->maxid) list->maxid = id;
+  if (2 * (index->n + 1) > index->len)
+    if (idIndexGrow(index) != TD_OK) return -1; // TODO: return error code
+
+  unsigned mask = index->len - 1;
+  unsigned i = idIndexHash(index, task, index->len);
+
+  for ( ; index->tasks[i]; i = (i + 1) & mask)
+    if (index->by_task ? index->tasks[i] == task : 
+        index->tasks[i]->id == task->id) {
+      index->tasks[i] = task;
+      return TD_OK;
+    }
+
+  index->tasks[i] = task;
+  index->n++;
 
-  cat->nopen += taskNumChildrenOpen(task) + !taskGetFlag(task, TF_COMPLETE);
-  cat->ntasks += taskNumChildren(task) + 1;
-  list->ntasks++;
-  
   return TD_OK;
 }
 
-int
-listAddKey(list_T list, const char *key)
+static task_T
+idIndexGet(const struct taskIndex *index, const int id)
 {
-  if (list->nkeys >= list->keys_len) {
-    list->keys_len <<= 1;
-    char **ptr = memResize(list->keys, list->keys_len * sizeof(char *));
-    if (!ptr) return -1; // TODO: return error code
-    else list->keys = ptr;
-  }
+  if (!index->len) return NULL;
 
-  list->keys[list->nkeys++] = strdup(key);
+  unsigned mask = index->len - 1;
+  unsigned i = idHash(id, index->len);
 
-  return TD_OK;
+  for ( ; index->tasks[i]; i = (i + 1) & mask)
+    if (index->tasks[i]->id == id) return index->tasks[i];
+
+  return NULL;
 }
 
-char *
-listName(const list_T list)
+static void
+idIndexRemove(struct taskIndex *index, const task_T task)
 {
-  if (!list) return NULL;
-  else return list->name;
+  if (!index->len || (!index->by_task && task->id == TASK_NOID)) return;
+
+  unsigned mask = index->len - 1;
+  unsigned i = idIndexHash(index, task, index->len);
+
+  for ( ; index->tasks[i] != task; i = (i + 1) & mask)
+    if (!index->tasks[i]) return;
+
+  index->tasks[i] = NULL;
+  index->n--;
+
+  // Move back any entry that can no longer be reached across the gap
+  // at i, i.e., whose home slot k isn't cyclically in (i, j]
+  for (unsigned j = (i + 1) & mask; index->tasks[j]; j = (j + 1) & mask) {
+    unsigned k = idIndexHash(index, index->tasks[j], index->len);
+    if (((j - k) & mask) >= ((j - i) & mask)) {
+      index->tasks[i] = index->tasks[j];
+      index->tasks[j] = NULL;
+      i = j;
+    }
+  }
 }
 
 int
-listNumKeys(const list_T list)
+catNumOpen(const cat_T cat)
 {
-  if (!list) return TD_INVALIDARG;
-  else return list->nkeys;
+  if (!cat) return 0;
+  return cat->nopen;
 }
 
-// TODO: make this interface consistent with the other ones
-char **
-listGetKeys(const list_T list)
+const char *
+catLabel(const cat_T cat)
 {
-  if (!list) return NULL;
-  else return list->keys;
+  if (!cat) return NULL;
+  else return cat->label;
 }
 
 int
-listContainsKey(const list_T list, const char *key)
-{
-  for (int i=0; i < listNumKeys(list); i++)
-    if (strcmp(list->keys[i], key) == 0) 
-      return 1;
-
-  return 0;
-}
-  
-cat_T
-listGetCat(const list_T list, const cat_T cat)
+catNumBranchOpen(const cat_T cat)
 {
-  if (!list) return NULL;
-  else if (!cat) return list->cat;
-  else return cat->link;
+  if (!cat) return 0;
+  return cat->nbranch_open;
 }
 
 int
-listNumUpdates(const list_T list)
+catIsFolded(const cat_T cat)
 {
-  if (!list) return 0;
-  else return list->nupdates;
+  if (!cat) return 0;
+  return cat->folded;
 }
 
-task_T *
-listGetUpdates(const list_T list)
+void
+catSetFolded(cat_T cat, const int folded)
 {
+  if (cat) cat->folded = folded;
+}
 
-  if (!list->nupdates) return NULL;
+// -----------------------------------------------------------------------------
+// History
+// -----------------------------------------------------------------------------
 
-  int len = 8, i = 0;
-  task_T *updates = memCalloc(len, sizeof(task_T));
-  if (!updates) return NULL;
-  task_T task;
+/**
+ * Each change to the list is kept as a step of items, each holding what
+ * one field, the flags or the links of a task were before the change.
+ * Applying an item swaps what it holds with what the task has now, so
+ * the same step undoes the change and then redoes it. Subtask counts
+ * are kept as the change made to the counts above a task, since those
+ * below it follow from the flags. Whole tasks are never copied.
+ */
+enum journalItems {
+  JI_FIELD  = 1,
+  JI_FLAGS  = 2,
+  JI_COUNTS = 3,
+  JI_LINK   = 4
+};
+
+struct journalItem {
+  int         type;
+  task_T      task;
+  const char *key;       // JI_FIELD: key of the field, an atom
+  char       *val;       // JI_FIELD, JI_LINK: value of the field or parent_id
+  int         flags;     // JI_FLAGS: flags other than TF_UPDATE
+  int         ntasks;    // JI_COUNTS: change to the counts above task
+  int         nopen;
+  int         recount;   // JI_COUNTS: whether to recount below task
+  int         linked;    // JI_LINK: whether task was in the list
+  task_T      parent;    // JI_LINK: parent task was linked under
+  task_T      prev;      // JI_LINK: sibling task followed, or NULL if first
+  const char *category;  // JI_LINK: category, an atom
+};
+
+struct journalStep {
+  struct journalItem *items;
+  int         nitems;
+  int         items_len;
+  task_T      dirty;     // updated tasks before the step
+  task_T     *marked;    // tasks the step marked as updated, once undone
+  int         nmarked;
+  int         nupdates;  // number of updates to swap in
+};
+
+struct journal {
+  struct journalStep **undo; // steps to undo, the most recent last
+  struct journalStep **redo; // steps to redo, the most recently undone last
+  int         nundo;
+  int         nredo;
+  int         depth;     // most steps kept to undo
+  int         pending;   // whether the next item starts a step
+  task_T      dirty;     // updated tasks when the pending step began
+  int         nupdates;  // number of updates when the pending step began
+};
 
-  cat_T cat = NULL;
-  while ((cat = listGetCat(list, cat))) {
-    task = NULL;
-    while ((task = catGetTask(cat, task))) {
-      if (task->flags & TF_UPDATE) {
-        if (i >= len - 2) {
-          len *= 2;
-          updates = memResize(updates, len * sizeof(task_T));
-          if (!updates) return NULL;
-        }
-        updates[i] = task;
-        i++;
-      }
-    }
-  }
+static void
+journalFreeStep(struct journalStep *step)
+{
+  for (int i=0; i < step->nitems; i++) free(step->items[i].val);
+  memFree(step->items);
+  memFree(step->marked);
+  memFree(step);
+}
 
-  updates[i] = NULL;
+static void
+journalClear(list_T list)
+{
+  struct journal *journal = list->journal;
+  if (!journal) return;
 
-  return updates;
+  while (journal->nundo) journalFreeStep(journal->undo[--journal->nundo]);
+  while (journal->nredo) journalFreeStep(journal->redo[--journal->nredo]);
+  journal->pending = 0;
 }
 
-int
-listClearUpdates(list_T list)
+static void
+journalFree(list_T list)
 {
-  cat_T cat = NULL;
-  while ((cat = listGetCat(list, cat))) {
+  if (!list->journal) return;
 
-    task_T task = NULL;
-    while ((task = catGetTask(cat, task)))
-      task->flags &= ~(TF_UPDATE);
+  journalClear(list);
+  memFree(list->journal->undo);
+  memFree(list->journal->redo);
+  memFree(list->journal);
+  list->journal = NULL;
+}
 
-  }
-  list->nupdates = 0;
+/**
+ * Starts a step for the next change. Only the functions that change the
+ * list for its callers start steps, so each is undone as a whole.
+ */
+static void
+journalBegin(list_T list)
+{
+  struct journal *journal = list->journal;
+  if (!journal) return;
 
-  return TD_OK;
+  journal->pending = 1;
+  journal->dirty = list->dirty;
+  journal->nupdates = list->nupdates;
 }
 
-// TODO: combine the logic of markComplete and markDelete
-int 
-markComplete(list_T list, task_T task)
+static struct journalStep *
+journalStep(list_T list)
 {
-  if (!task) return TD_INVALIDARG;
-  cat_T cat = getCategory(list, taskGet(task, "category"));
-  if (!cat) return -1; // TODO: return error code
+  struct journal *journal = list->journal;
+  if (!journal->pending) 
+    return journal->nundo ? journal->undo[journal->nundo-1] : NULL;
 
-  int stop = task->level;
-  do {
-    if (!taskGetFlag(task, TF_DELETE)) {
+  struct journalStep *step = memCalloc(1, sizeof(*step));
+  if (!step) return NULL;
 
-      taskSet(task, "status", "Complete");
-      list->nupdates += !(task->flags & TF_UPDATE);
-      if (!taskGetFlag(task, TF_COMPLETE)) 
-        cat->nopen--;
-      taskSetFlag(task, TF_UPDATE | TF_COMPLETE);
+  step->dirty = journal->dirty;
+  step->nupdates = journal->nupdates;
 
-    }
-    task = catGetTask(NULL, task);
-  } while (task && task->level > stop);
+  // Steps that were undone can't be redone after a new change
+  while (journal->nredo) journalFreeStep(journal->redo[--journal->nredo]);
 
-  return TD_OK;
+  if (journal->nundo == journal->depth) {
+    journalFreeStep(journal->undo[0]);
+    memmove(journal->undo, journal->undo + 1, 
+      (journal->depth - 1) * sizeof(*journal->undo));
+    journal->nundo--;
+  }
+
+  journal->undo[journal->nundo++] = step;
+  journal->pending = 0;
+
+  return step;
 }
 
-int 
-markDelete(list_T list, task_T task)
+/**
+ * Adds an item to the current step. If it can't, the history is dropped,
+ * since undoing only part of a change would leave the list inconsistent
+ */
+static struct journalItem *
+journalItem(list_T list, const int type, task_T task)
 {
-  if (!task) return TD_INVALIDARG;
-  cat_T cat = getCategory(list, taskGet(task, "category"));
-  if (!cat) return -1; // TODO: return error code
+  if (!list->journal) return NULL;
+
+  struct journalStep *step = journalStep(list);
+  if (step && step->nitems >= step->items_len) {
+    int len = step->items_len ? step->items_len << 1 : 8;
+    struct journalItem *items = step->items ? 
+      memResize(step->items, len * sizeof(*items)) :
+      memCalloc(len, sizeof(*items));
+    if (items) {
+      step->items = items;
+      step->items_len = len;
+    } else step = NULL;
+  }
 
-  int stop = task->level;
-  do {
-    if (!(taskGetFlag(task, TF_DELETE) || taskGetFlag(task, TF_COMPLETE)))
-      cat->nopen--;
+  if (!step) {
+    journalClear(list);
+    return NULL;
+  }
 
-    if (taskGetFlag(task, TF_NEW)) {
-      taskUnsetFlag(task, TF_NEW);
-      list->nupdates--;
-    } else 
-      list->nupdates += !(task->flags & TF_UPDATE);
+  struct journalItem *item = &step->items[step->nitems++];
+  memset(item, 0, sizeof(*item));
+  item->type = type;
+  item->task = task;
 
-    taskSetFlag(task, TF_UPDATE | TF_DELETE);
-    task = catGetTask(NULL, task);
-  } while (task && task->level > stop);
+  return item;
+}
 
-  return TD_OK;
+static char *
+journalCopy(const char *val)
+{
+  return val ? strdup(val) : NULL;
 }
-  
-int
+
+// Called before the field is set
+static void
+journalField(list_T list, task_T task, const char *key)
+{
+  struct journalItem *item = journalItem(list, JI_FIELD, task);
+  if (!item) return;
+
+  item->key = atomString(key);
+  item->val = journalCopy(taskGet(task, key));
+}
+
+// Called before any flag other than TF_UPDATE is set or unset
+static void
+journalFlags(list_T list, task_T task)
+{
+  struct journalItem *item = journalItem(list, JI_FLAGS, task);
+  if (item) item->flags = task->flags & ~TF_UPDATE;
+}
+
+/**
+ * Called when ntasks and nopen are added to the counts above task. When
+ * recount is set, the counts below task are also recounted when undone,
+ * as after flags are set on a whole subtree, which is done both before
+ * and after the flags so that it follows them either way
+ */
+static void
+journalCounts(list_T list, task_T task, const int ntasks, const int nopen,
+  const int recount)
+{
+  struct journalItem *item = journalItem(list, JI_COUNTS, task);
+  if (!item) return;
+
+  item->ntasks = ntasks;
+  item->nopen = nopen;
+  item->recount = recount;
+}
+
+/**
+ * Called before the fields and flags of task are replaced by those of
+ * new. The category and parent_id are left to journalLink
+ */
+static void
+journalChanges(list_T list, task_T task, task_T new)
+{
+  if (!list->journal) return;
+
+  for (int i=0; i < list->nkeys; i++) {
+    if (i == list->slots[LS_CATEGORY] || i == list->slots[LS_PARENTID])
+      continue;
+
+    const char *old_val = taskGetSlot(task, i), *val = taskGetSlot(new, i);
+    if (old_val == val || (old_val && val && strcmp(old_val, val) == 0))
+      continue;
+
+    journalField(list, task, list->keys[i]);
+  }
+
+  // The flags of new are added to those of task
+  if ((task->flags | new->flags) != task->flags) journalFlags(list, task);
+}
+
+// Tasks without ids are in the list but not in the index, so the list
+// keeps track of which tasks it holds itself
+static int
+taskIsLinked(const task_T task)
+{
+  return task->linked;
+}
+
+/**
+ * Called before task is unlinked, or before a new task is linked. The
+ * category and parent_id of task are kept with its links rather than
+ * as fields, since they have to match where it's linked.
+ */
+static void
+journalLink(list_T list, task_T task)
+{
+  struct journalItem *item = journalItem(list, JI_LINK, task);
+  if (!item) return;
+
+  item->linked = taskIsLinked(task);
+  item->parent = task->parent;
+  item->prev = task->llink;
+  item->category = atomString(listTaskGet(list, task, LS_CATEGORY));
+  item->val = journalCopy(listTaskGet(list, task, LS_PARENTID));
+}
+
+// -----------------------------------------------------------------------------
+// Columns
+// -----------------------------------------------------------------------------
+
+/**
+ * A column holds the value of one key for each task in the list, as the
+ * code of the value in the column's distinct values. Tasks are given rows
+ * as they're added, and a task that leaves the list gives its row to the
+ * task in the last row, so the rows stay packed.
+ */
+struct column {
+  int         *codes;    // code of the value in each row
+  const char **vals;     // distinct values, by code
+  int          nvals;
+  int          vals_len;
+  int         *hash;     // codes plus one by hash of their values, 0 if empty
+  int          hash_len; // a power of 2
+};
+
+struct columns {
+  struct column *cols;   // the columns of the list's keys, in the same order
+  int            ncols;
+  task_T        *rows;   // task in each row, row 0 is left empty
+  int            nrows;
+  int            rows_len;
+  int            built;  // whether the rows have been filled from the list
+  arena_T        arena;  // holds the distinct values
+};
+
+static unsigned
+valHash(const char *val, const int len)
+{
+  unsigned hash = 2166136261u;
+  for (; *val; val++) hash = (hash ^ (unsigned char) *val) * 16777619u;
+
+  return hash & (len - 1);
+}
+
+static int
+columnGrow(struct column *col)
+{
+  int len = col->hash_len ? col->hash_len << 1 : 64;
+  int *hash = memCalloc(len, sizeof(int));
+  if (!hash) return -1; // TODO: return error code
+
+  for (int code=0; code < col->nvals; code++) {
+    unsigned i = valHash(col->vals[code], len);
+    while (hash[i]) i = (i + 1) & (len - 1);
+    hash[i] = code + 1;
+  }
+
+  memFree(col->hash);
+  col->hash = hash;
+  col->hash_len = len;
+
+  return TD_OK;
+}
+
+// Returns the code of val in the column, giving it one if it's new
+static int
+columnCode(struct columns *columns, struct column *col, const char *val)
+{
+  if (!val) val = "";
+
+  // Keep the table at most half full
+  if (2 * (col->nvals + 1) > col->hash_len && columnGrow(col) != TD_OK)
+    return -1; // TODO: return error code
+
+  unsigned i = valHash(val, col->hash_len);
+  for (; col->hash[i]; i = (i + 1) & (col->hash_len - 1))
+    if (strcmp(col->vals[col->hash[i] - 1], val) == 0)
+      return col->hash[i] - 1;
+
+  if (col->nvals >= col->vals_len) {
+    int len = col->vals_len ? col->vals_len << 1 : 64;
+    const char **vals = col->vals 
+      ? memResize(col->vals, len * sizeof(char *))
+      : memCalloc(len, sizeof(char *));
+    if (!vals) return -1; // TODO: return error code
+
+    col->vals = vals;
+    col->vals_len = len;
+  }
+
+  const char *copy = arenaStrdup(columns->arena, val);
+  if (!copy) return -1; // TODO: return error code
+
+  col->vals[col->nvals] = copy;
+  col->hash[i] = col->nvals + 1;
+
+  return col->nvals++;
+}
+
+static int
+columnsAddRow(struct columns *columns, task_T task)
+{
+  if (columns->nrows >= columns->rows_len) {
+    int len = columns->rows_len << 1;
+    task_T *rows = memResize(columns->rows, len * sizeof(task_T));
+    if (!rows) return -1; // TODO: return error code
+    columns->rows = rows;
+
+    for (int i=0; i < columns->ncols; i++) {
+      int *codes = memResize(columns->cols[i].codes, len * sizeof(int));
+      if (!codes) return -1; // TODO: return error code
+      columns->cols[i].codes = codes;
+    }
+
+    columns->rows_len = len;
+  }
+
+  task->row = columns->nrows++;
+  columns->rows[task->row] = task;
+
+  return TD_OK;
+}
+
+static void
+columnsRemoveRow(struct columns *columns, task_T task)
+{
+  int last = --columns->nrows;
+
+  if (task->row != last) {
+    task_T moved = columns->rows[last];
+    moved->row = task->row;
+    columns->rows[moved->row] = moved;
+
+    for (int i=0; i < columns->ncols; i++)
+      columns->cols[i].codes[moved->row] = columns->cols[i].codes[last];
+  }
+
+  task->row = 0;
+}
+
+// The columns are filled again when they're next used
+static void
+columnsReset(list_T list)
+{
+  struct columns *columns = list->columns;
+  if (!columns) return;
+
+  for (int row=1; row < columns->nrows; row++) columns->rows[row]->row = 0;
+
+  for (int i=0; i < columns->ncols; i++) {
+    memFree(columns->cols[i].codes);
+    memFree(columns->cols[i].vals);
+    memFree(columns->cols[i].hash);
+  }
+
+  memFree(columns->cols);
+  memFree(columns->rows);
+  arenaFree(&columns->arena);
+  memset(columns, 0, sizeof(*columns));
+}
+
+static void
+columnsFree(list_T list)
+{
+  columnsReset(list);
+  memFree(list->columns);
+  list->columns = NULL;
+}
+
+// Sets the codes of the task's row from its fields
+static int
+columnsSetRow(struct columns *columns, task_T task)
+{
+  for (int i=0; i < columns->ncols; i++) {
+    int code = columnCode(columns, &columns->cols[i], taskGetSlot(task, i));
+    if (code < 0) return -1; // TODO: return error code
+    columns->cols[i].codes[task->row] = code;
+  }
+
+  return TD_OK;
+}
+
+/**
+ * Called once task has changed, to add it to, update or drop it from the
+ * columns, if they've been filled. If a row can't be set, the columns
+ * are filled again when they're next used.
+ */
+static void
+columnsUpdate(list_T list, task_T task)
+{
+  struct columns *columns = list->columns;
+  if (!(columns && columns->built)) return;
+
+  if (!taskIsLinked(task)) {
+    if (task->row) columnsRemoveRow(columns, task);
+    return;
+  }
+
+  if ((!task->row && columnsAddRow(columns, task) != TD_OK) ||
+      columnsSetRow(columns, task) != TD_OK)
+    columnsReset(list);
+}
+
+// Walks the list once, the first time the columns are used
+static int
+columnsBuild(list_T list)
+{
+  struct columns *columns = list->columns;
+  if (columns->built) return TD_OK;
+
+  columns->ncols = list->nkeys;
+  columns->cols = memCalloc(list->nkeys ? list->nkeys : 1,
+    sizeof(*columns->cols));
+  columns->rows_len = 1024;
+  columns->nrows = 1;
+  columns->rows = memCalloc(columns->rows_len, sizeof(task_T));
+  columns->arena = arenaNew();
+  if (!(columns->cols && columns->rows && columns->arena)) {
+    columnsReset(list);
+    return -1; // TODO: return error code
+  }
+
+  for (int i=0; i < columns->ncols; i++) {
+    columns->cols[i].codes = memCalloc(columns->rows_len, sizeof(int));
+    if (!columns->cols[i].codes) {
+      columnsReset(list);
+      return -1; // TODO: return error code
+    }
+  }
+
+  for (cat_T cat=list->cat; cat; cat=cat->link) {
+    struct taskIter it;
+    catIterInit(&it, cat);
+
+    task_T task;
+    while ((task = taskIterNext(&it)))
+      if (columnsAddRow(columns, task) != TD_OK ||
+          columnsSetRow(columns, task) != TD_OK) {
+        columnsReset(list);
+        return -1; // TODO: return error code
+      }
+  }
+
+  columns->built = 1;
+
+  return TD_OK;
+}
+
+int
+listSetColumns(list_T list, const int on)
+{
+  if (!list) return TD_INVALIDARG;
+
+  if (!on) columnsFree(list);
+  else if (!list->columns) {
+    list->columns = memCalloc(1, sizeof(*list->columns));
+    if (!list->columns) return -1; // TODO: return error code
+  }
+
+  return TD_OK;
+}
+
+/**
+ * Each term is checked once for each distinct value of its key, and then
+ * the rows are scanned, clearing those whose code doesn't match. A term
+ * on a key the list doesn't have is checked against "".
+ */
+static task_T *
+columnsFilter(list_T list, const filter_T filter)
+{
+  if (columnsBuild(list) != TD_OK) return NULL;
+
+  struct columns *columns = list->columns;
+  int nrows = columns->nrows;
+
+  unsigned char *match = memAlloc(nrows);
+  if (!match) return NULL;
+  memset(match, 1, nrows);
+
+  for (int term=0; term < filterNumTerms(filter); term++) {
+    int slot = listKeySlot(list, filterTermKey(filter, term));
+    if (slot < 0 || slot >= columns->ncols) {
+      if (!filterTermMatch(filter, term, "")) memset(match, 0, nrows);
+      continue;
+    }
+
+    struct column *col = &columns->cols[slot];
+    unsigned char *hits = memAlloc(col->nvals ? col->nvals : 1);
+    if (!hits) {
+      memFree(match);
+      return NULL;
+    }
+
+    for (int code=0; code < col->nvals; code++)
+      hits[code] = filterTermMatch(filter, term, col->vals[code]);
+
+    const int *codes = col->codes;
+    for (int row=1; row < nrows; row++) match[row] &= hits[codes[row]];
+
+    memFree(hits);
+  }
+
+  // Row 0 is empty, so there's room for the NULL at the end
+  task_T *tasks = memCalloc(nrows, sizeof(task_T));
+  if (tasks) {
+    int n = 0;
+    for (int row=1; row < nrows; row++)
+      if (match[row]) tasks[n++] = columns->rows[row];
+  }
+
+  memFree(match);
+
+  return tasks;
+}
+
+task_T *
+listFilterTasks(list_T list, const filter_T filter)
+{
+  if (!(list && filter)) return NULL;
+  if (list->columns) return columnsFilter(list, filter);
+
+  // Tasks without ids are walked but aren't in the index, so the array is
+  // sized by the count of every task in the list
+  task_T *tasks = memCalloc(list->ntasks + 1, sizeof(task_T));
+  if (!tasks) return NULL;
+
+  int n = 0;
+  for (cat_T cat=list->cat; cat; cat=cat->link) {
+    struct taskIter it;
+    catIterInit(&it, cat);
+
+    task_T task;
+    while ((task = taskIterNext(&it)))
+      if (filterMatch(filter, task)) tasks[n++] = task;
+  }
+
+  return tasks;
+}
+
+// -----------------------------------------------------------------------------
+// Saved views
+// -----------------------------------------------------------------------------
+
+struct view_T {
+  const char      *name;  // an atom
+  filter_T         filter;
+  int              built; // whether tasks has been filled from the list
+  struct taskIndex tasks; // tasks in the view, by address
+  struct view_T   *link;  // next view of the list
+};
+
+// Tasks that are shown in the list, and neither complete nor deleted, are
+// in a view if they match it
+static int
+taskIsViewable(const task_T task)
+{
+  if (taskGetStatus(task) == TS_COMPLETE || taskGetFlag(task, TF_COMPLETE) ||
+      taskGetFlag(task, TF_DELETE)) return 0;
+
+  return taskIsLinked(task);
+}
+
+static int
+viewHasTask(const view_T view, const task_T task)
+{
+  return taskIsViewable(task) && filterMatch(view->filter, task);
+}
+
+// Empties the view, which is built again when it's next used
+static void
+viewReset(view_T view)
+{
+  memFree(view->tasks.tasks);
+  memset(&view->tasks, 0, sizeof(view->tasks));
+  view->tasks.by_task = 1;
+  view->built = 0;
+}
+
+/**
+ * Called once task has changed, to add it to or drop it from each view
+ * that's been built. Only task is checked, not the tasks below it. A view
+ * that can't hold task is reset rather than left without it
+ */
+static void
+viewsUpdate(list_T list, task_T task)
+{
+  for (view_T view=list->views; view; view=view->link) {
+    if (!view->built) continue;
+
+    if (!viewHasTask(view, task)) idIndexRemove(&view->tasks, task);
+    else if (idIndexPut(&view->tasks, task) != TD_OK) viewReset(view);
+  }
+}
+
+static void
+viewsReset(list_T list)
+{
+  for (view_T view=list->views; view; view=view->link) viewReset(view);
+}
+
+static void
+viewsFree(list_T list)
+{
+  for (view_T view=list->views; view; view=view->link) {
+    filterFree(&view->filter);
+    memFree(view->tasks.tasks);
+  }
+}
+
+// Walks the list once, the first time the view's tasks are asked for, or
+// scans the columns if they're kept
+static int
+viewBuild(list_T list, view_T view)
+{
+  if (view->built) return TD_OK;
+
+  if (list->columns) {
+    task_T *tasks = listFilterTasks(list, view->filter);
+    if (!tasks) return -1; // TODO: return error code
+
+    for (int i=0; tasks[i]; i++)
+      if (taskIsViewable(tasks[i]) &&
+          idIndexPut(&view->tasks, tasks[i]) != TD_OK) {
+        memFree(tasks);
+        viewReset(view);
+        return -1; // TODO: return error code
+      }
+
+    memFree(tasks);
+    view->built = 1;
+
+    return TD_OK;
+  }
+
+  for (cat_T cat=list->cat; cat; cat=cat->link) {
+    struct taskIter it;
+    catIterInit(&it, cat);
+
+    task_T task;
+    while ((task = taskIterNext(&it))) {
+      if (taskGetFlag(task, TF_DELETE)) {
+        taskIterSkip(&it);
+        continue;
+      }
+
+      if (viewHasTask(view, task) &&
+          idIndexPut(&view->tasks, task) != TD_OK) {
+        viewReset(view);
+        return -1; // TODO: return error code
+      }
+    }
+  }
+
+  view->built = 1;
+
+  return TD_OK;
+}
+
+view_T
+listAddView(list_T list, const char *name, const char *query)
+{
+  if (!(list && name)) return NULL;
+
+  // The position orders siblings, and isn't kept up to date in views
+  filter_T filter = filterNew(query);
+  if (!filter || filterHasKey(filter, slot_keys[LS_POSITION])) {
+    filterFree(&filter);
+    return NULL;
+  }
+
+  name = atomString(name);
+  view_T *link;
+  for (link=&list->views; *link && (*link)->name != name; 
+    link=&(*link)->link) ;
+
+  view_T view = *link;
+  if (!view) {
+    view = arenaCalloc(list->arena, 1, sizeof(*view));
+    if (!view) {
+      filterFree(&filter);
+      return NULL;
+    }
+
+    view->name = name;
+    *link = view;
+  }
+
+  filterFree(&view->filter);
+  view->filter = filter;
+  viewReset(view);
+
+  return view;
+}
+
+view_T
+listGetView(const list_T list, const char *name)
+{
+  if (!(list && name)) return NULL;
+
+  name = atomString(name);
+  view_T view;
+  for (view=list->views; view && view->name != name; view=view->link) ;
+
+  return view;
+}
+
+view_T
+listNextView(const list_T list, const view_T view)
+{
+  if (!list) return NULL;
+  else return view ? view->link : list->views;
+}
+
+const char *
+viewName(const view_T view)
+{
+  if (!view) return NULL;
+  else return view->name;
+}
+
+int
+listViewNumTasks(list_T list, view_T view)
+{
+  if (!(list && view)) return TD_INVALIDARG;
+  if (viewBuild(list, view) != TD_OK) return -1; // TODO: return error code
+
+  return view->tasks.n;
+}
+
+struct viewEntry {
+  const char *category;
+  task_T      task;
+};
+
+static int
+viewEntryCompare(const void *a, const void *b)
+{
+  const struct viewEntry *x = a, *y = b;
+
+  int cmp = x->category == y->category ? 0 : strcmp(x->category, y->category);
+  if (cmp) return cmp;
+
+  // Tasks without ids go first, in the order they're held in memory
+  if (x->task->id != y->task->id)
+    return (x->task->id > y->task->id) - (x->task->id < y->task->id);
+  uintptr_t p = (uintptr_t) x->task, q = (uintptr_t) y->task;
+  return (p > q) - (p < q);
+}
+
+task_T *
+listViewGetTasks(list_T list, view_T view)
+{
+  if (!(list && view)) return NULL;
+  if (viewBuild(list, view) != TD_OK) return NULL;
+
+  int n = 0;
+  struct viewEntry *entries = memCalloc(view->tasks.n + 1, sizeof(*entries));
+  if (!entries) return NULL;
+
+  for (int i=0; i < view->tasks.len; i++) {
+    task_T task = view->tasks.tasks[i];
+    if (!task) continue;
+
+    const char *category = listTaskGet(list, task, LS_CATEGORY);
+    entries[n].category = category ? category : "";
+    entries[n++].task = task;
+  }
+
+  qsort(entries, n, sizeof(*entries), viewEntryCompare);
+
+  task_T *tasks = memCalloc(n + 1, sizeof(task_T));
+  if (tasks)
+    for (int i=0; i < n; i++) tasks[i] = entries[i].task;
+
+  memFree(entries);
+
+  return tasks;
+}
+
+/**
+ * Called once task has changed, to bring the views and columns that
+ * follow its fields up to date
+ */
+static void
+taskChanged(list_T list, task_T task)
+{
+  viewsUpdate(list, task);
+  columnsUpdate(list, task);
+}
+
+// -----------------------------------------------------------------------------
+// List
+// -----------------------------------------------------------------------------
+
+/**
+ * The list, its categories, its tasks and their fields are all
+ * allocated from an arena, so listFree releases them together
+ * without walking the tasks
+ */
+list_T
+listNew(const char *name)
+{
+  arena_T arena = arenaNew();
+  if (!arena) return NULL;
+
+  list_T list;
+  list = arenaCalloc(arena, 1, sizeof(*list));
+  if (!list) {
+    arenaFree(&arena);
+    return NULL;
+  }
+
+  list->arena = arena;
+  list->name = arenaStrdup(arena, name);
+
+  for (int i=0; i < LS_NSLOTS; i++)
+    list->slots[i] = -1;
+
+  list->keys_len = 8;
+  list->keys = memCalloc(8, sizeof(char *));
+  if (!list->keys) {
+    arenaFree(&arena);
+    return NULL;
+  }
+
+  list->pool = taskPoolNew(arena);
+  if (!list->pool) {
+    free(list->keys);
+    arenaFree(&arena);
+    return NULL;
+  }
+
+  return list;
+}
+
+task_T
+listNewTask(list_T list)
+{
+  if (!list) return NULL;
+
+  // The fields are made in the order of the list's keys up front, so
+  // they don't have to be moved as they're set
+  task_T task = taskPoolAlloc(list->pool);
+  if (task && list->nkeys &&
+      taskConform(task, list->keys, list->nkeys) != TD_OK) {
+    taskFree(&task);
+    return NULL;
+  }
+
+  return task;
+}
+
+void
+listFree(list_T *list)
+{
+  if (!(list && *list)) return;
+
+  // The list itself lives in the arena
+  arena_T arena = (*list)->arena;
+  journalFree(*list);
+  viewsFree(*list);
+  columnsFree(*list);
+  memFree((*list)->index.tasks);
+  memFree((*list)->cat_index);
+  free((*list)->keys);
+  arenaFree(&arena);
+
+  *list = NULL;
+}
+
+task_T
+listFindTaskById(const list_T list, const int id)
+{
+  if (!list || id == TASK_NOID) return NULL;
+  else return idIndexGet(&list->index, id);
+}
+
+cat_T
+listFindCat(const list_T list, const char *name)
+{
+  if (!(list && name)) return NULL;
+  else return catIndexGet(list, atomString(name));
+}
+
+/**
+ * This deletes the category and relinks the list.
+ * The category's memory stays in the list's arena
+ * until the list is freed. A category with others
+ * nested in it stays, and one left with neither
+ * tasks nor nested categories goes too
+ */
+static int
+listDeleteCat(list_T list, cat_T *cat)
+{
+  if (!(list && cat && *cat)) return TD_INVALIDARG;
+
+  cat_T node, parent;
+  for (node=*cat; node && !node->tasks && !node->child; node=parent) {
+    parent = node->parent;
+
+    if (list->cat == node) list->cat = node->link;
+    else {
+      cat_T prev = list->cat;
+      for ( ; prev->link != node; prev=prev->link ) ;
+      prev->link = node->link;
+    }
+
+    cat_T *sibling = parent ? &parent->child : &list->cat_tree;
+    for ( ; *sibling != node; sibling=&(*sibling)->sibling) ;
+    *sibling = node->sibling;
+
+    catIndexRemove(list, node);
+    list->ncats--;
+  }
+
+  *cat = NULL;
+
+  return TD_OK;
+}
+
+/**
+ * Flags the task as updated and, the first time, links it into the
+ * list's updated tasks. Only tasks flagged here are in that list, so
+ * tasks that arrive already flagged have the flag unset first.
+ */
+static void
+listMarkUpdate(list_T list, task_T task)
+{
+  if (taskGetFlag(task, TF_UPDATE)) return;
+
+  // A change that only marks tasks is still undone, to unmark them
+  if (list->journal && !journalStep(list)) journalClear(list);
+
+  taskSetFlag(task, TF_UPDATE);
+  task->dirty = list->dirty;
+  list->dirty = task;
+  list->nupdates++;
+}
+
+// -----------------------------------------------------------------------------
+// Subtask counts
+// -----------------------------------------------------------------------------
+
+/**
+ * Each task counts the tasks below it and how many of those are open.
+ * Deleted tasks aren't counted, and complete ones aren't open. The
+ * counts of a category are kept the same way for its tasks.
+ */
+static int
+taskIsCounted(const task_T task)
+{
+  return !taskGetFlag(task, TF_DELETE);
+}
+
+static int
+taskIsOpen(const task_T task)
+{
+  return !(taskGetFlag(task, TF_COMPLETE) || taskGetFlag(task, TF_DELETE));
+}
+
+/**
+ * Adds ntasks and nopen to the counts of the ancestors of task and of
+ * the category its tree is in, in time linear to the depth of task
+ */
+static void
+taskPropagateCounts(list_T list, task_T task, const int ntasks, 
+  const int nopen)
+{
+  for ( ; task->parent; task=task->parent) {
+    task->parent->nsubtasks += ntasks;
+    task->parent->nopen += nopen;
+  }
+
+  cat_T cat = getCategory(list, listTaskGet(list, task, LS_CATEGORY));
+  if (!cat) return;
+
+  cat->ntasks += ntasks;
+  cat->nopen += nopen;
+
+  for ( ; cat; cat=cat->parent) cat->nbranch_open += nopen;
+}
+
+/**
+ * Sets the levels of task and its subtasks from level, and recounts
+ * their subtasks, whatever they were before
+ */
+static void
+taskSetSubtree(task_T task, const int level)
+{
+  task_T node = task;
+  while (node) {
+    node->level = node == task ? level : node->parent->level + 1;
+    node->nsubtasks = node->nopen = 0;
+
+    if (node->child) {
+      node = node->child;
+      continue;
+    }
+
+    // Once a node's subtree is done, its counts are added to its parent,
+    // climbing until there's a next sibling or we're back at task
+    while (node != task) {
+      task_T up = node->parent;
+      up->nsubtasks += node->nsubtasks + taskIsCounted(node);
+      up->nopen += node->nopen + taskIsOpen(node);
+
+      if (node->rlink) break;
+      node = up;
+    }
+
+    node = node == task ? NULL : node->rlink;
+  }
+}
+
+/**
+ * Unlinks task, along with its subtasks, from its siblings and takes its
+ * counts off of its ancestors and category. The category goes if it's
+ * left empty. The task stays in the index
+ */
+static void
+taskDetach(list_T list, task_T task)
+{
+  cat_T cat = getCategory(list, listTaskGet(list, task, LS_CATEGORY));
+
+  // Update accounting for ntasks and nopen while we still have a parent
+  taskPropagateCounts(list, task, -(task->nsubtasks + taskIsCounted(task)),
+    -(task->nopen + taskIsOpen(task)));
+
+  // If we're the first task in category,
+  // then there isn't a parent
+  if (cat->tasks == task) cat->tasks = task->rlink;
+
+  // Otherwise, check if we're the first child of a parent
+  else if (task->parent && task->parent->child == task) 
+    task->parent->child = task->rlink;
+      
+  // If none of these, then there is a left link to adjust
+  else if (task->llink) task->llink->rlink = task->rlink;
+
+  if (task->rlink) task->rlink->llink = task->llink;
+
+  // Sever the task from the tree
+  task->parent = task->llink = task->rlink = NULL;
+
+  // If we were the only task in the category, it goes too
+  if (!cat->tasks) listDeleteCat(list, &cat);
+}
+
+static int
+listPopTask(list_T list, task_T task)
+{
+  if (!(list && task)) return TD_INVALIDARG;
+
+  taskDetach(list, task);
+  idIndexRemove(&list->index, task);
+  task->linked = 0;
+  columnsUpdate(list, task);
+  list->ntasks--;
+
+  return TD_OK;
+}
+
+// -----------------------------------------------------------------------------
+// Sibling order
+// -----------------------------------------------------------------------------
+
+/**
+ * Returns the position of task, or NULL if it doesn't have a valid one
+ * or the list doesn't have positions
+ */
+static const char *
+taskPosition(const list_T list, const task_T task)
+{
+  if (!task || list->slots[LS_POSITION] < 0) return NULL;
+
+  const char *pos = taskGetSlot(task, list->slots[LS_POSITION]);
+  return positionIsValid(pos) ? pos : NULL;
+}
+
+/**
+ * Links task between prev and next, where prev is NULL if it's first
+ */
+static void
+taskLinkBetween(task_T task, task_T *head, task_T prev, task_T next)
+{
+  task->llink = prev;
+  task->rlink = next;
+  if (next) next->llink = task;
+  if (prev) prev->rlink = task;
+  else *head = task;
+}
+
+/**
+ * Links a task without a position first among the siblings at *head,
+ * giving it a position before theirs. If they don't have positions
+ * yet, neither does task, so they stay in the same order when loaded
+ */
+static void
+taskLinkFirst(list_T list, task_T task, task_T *head)
+{
+  task_T next = *head;
+  taskLinkBetween(task, head, NULL, next);
+  if (list->slots[LS_POSITION] < 0) return;
+
+  char pos[POSITION_LEN] = "";
+  const char *hi = taskPosition(list, next);
+  if ((!next || hi) && positionBetween(pos, sizeof(pos), NULL, hi) != TD_OK)
+    *pos = '\0';
+
+  journalField(list, task, slot_keys[LS_POSITION]);
+  taskSet(task, slot_keys[LS_POSITION], pos);
+  columnsUpdate(list, task);
+}
+
+/**
+ * Links task among the siblings at *head, before the first one with a
+ * later position, or first if it doesn't have a position
+ */
+static void
+taskLinkSibling(list_T list, task_T task, task_T *head)
+{
+  const char *pos = taskPosition(list, task);
+  if (!pos) {
+    taskLinkFirst(list, task, head);
+    return;
+  }
+
+  task_T prev = NULL, next = *head;
+  for ( ; next; prev=next, next=next->rlink) {
+    const char *next_pos = taskPosition(list, next);
+    if (next_pos && strcmp(next_pos, pos) > 0) break;
+  }
+
+  taskLinkBetween(task, head, prev, next);
+}
+
+/**
+ * Gives each of the siblings from first on a new position, in order
+ */
+static int
+listRenumberSiblings(list_T list, task_T first)
+{
+  char pos[POSITION_LEN], prev[POSITION_LEN];
+
+  for (task_T task=first; task; task=task->rlink) {
+    if (positionBetween(pos, sizeof(pos), task == first ? NULL : prev, NULL)
+      != TD_OK) return -1; // TODO: return error code
+
+    journalField(list, task, slot_keys[LS_POSITION]);
+    taskSet(task, slot_keys[LS_POSITION], pos);
+    columnsUpdate(list, task);
+    listMarkUpdate(list, task);
+    strcpy(prev, pos);
+  }
+
+  return TD_OK;
+}
+
+/**
+ * Gives task, once it's linked between its new siblings, a position
+ * between theirs. Only task needs a new position, unless its neighbors
+ * have none or repeated moves into the same gap have used up POSITION_LEN
+ */
+static int
+taskPlaceBetween(list_T list, task_T task, task_T *head)
+{
+  if (list->slots[LS_POSITION] < 0) return TD_OK;
+
+  char pos[POSITION_LEN];
+  task_T prev = task->llink, next = task->rlink;
+  const char *lo = taskPosition(list, prev), *hi = taskPosition(list, next);
+  if ((prev && !lo) || (next && !hi) ||
+      positionBetween(pos, sizeof(pos), lo, hi) != TD_OK)
+    return listRenumberSiblings(list, *head);
+
+  journalField(list, task, slot_keys[LS_POSITION]);
+  taskSet(task, slot_keys[LS_POSITION], pos);
+  columnsUpdate(list, task);
+  listMarkUpdate(list, task);
+
+  return TD_OK;
+}
+
+// Completed and deleted tasks aren't shown, so moves pass over them
+static int
+taskIsShown(const task_T task)
+{
+  return taskGetStatus(task) != TS_COMPLETE && !taskGetFlag(task, TF_DELETE);
+}
+
+int
+listMoveTask(list_T list, task_T task, const int offset)
+{
+  if (!(list && task) || list->slots[LS_POSITION] < 0) return TD_INVALIDARG;
+  if (!taskIsShown(task)) return TD_INVALIDARG;
+
+  task_T sib = task;
+  do sib = offset < 0 ? sib->llink : sib->rlink;
+  while (sib && !taskIsShown(sib));
+  if (!sib) return TD_INVALIDARG;
+
+  task_T *head;
+  if (task->parent) head = &task->parent->child;
+  else head = &getCategory(list, listTaskGet(list, task, LS_CATEGORY))->tasks;
+
+  journalBegin(list);
+  journalLink(list, task);
+
+  // Unlink task from its siblings
+  if (task->llink) task->llink->rlink = task->rlink;
+  else *head = task->rlink;
+  if (task->rlink) task->rlink->llink = task->llink;
+
+  task_T prev = offset < 0 ? sib->llink : sib;
+  task_T next = offset < 0 ? sib : sib->rlink;
+  taskLinkBetween(task, head, prev, next);
+
+  return taskPlaceBetween(list, task, head);
+}
+
+int
+listMoveSubtree(list_T list, task_T task, task_T parent, task_T prev,
+  const char *category)
+{
+  if (!(list && task)) return TD_INVALIDARG;
+  if (!taskIsShown(task) || (parent && !taskIsShown(parent)))
+    return TD_INVALIDARG;
+  if (taskIsDescendant(parent, task)) return TD_INVALIDARG;
+  if (prev && (prev == task || prev->parent != parent)) return TD_INVALIDARG;
+
+  if (parent) category = listTaskGet(list, parent, LS_CATEGORY);
+  else if (!category) category = listTaskGet(list, task, LS_CATEGORY);
+  if (!category) return TD_INVALIDARG;
+
+  // The category may be one of the task's own fields, which changes below
+  category = atomString(category);
+
+  if (prev && !parent && strcmp(listTaskGet(list, prev, LS_CATEGORY), category))
+    return TD_INVALIDARG;
+
+  int recategorize = strcmp(listTaskGet(list, task, LS_CATEGORY), category);
+
+  journalBegin(list);
+  journalLink(list, task);
+  taskDetach(list, task);
+
+  // Subtasks only have to be written if their category changes
+  if (recategorize) {
+    struct taskIter it;
+    taskIterInit(&it, task);
+
+    task_T node;
+    while ((node = taskIterNext(&it))) {
+      if (node != task) journalField(list, node, slot_keys[LS_CATEGORY]);
+      taskSet(node, slot_keys[LS_CATEGORY], category);
+      listMarkUpdate(list, node);
+      taskChanged(list, node);
+    }
+  }
+
+  cat_T cat = getCategory(list, category);
+  if (!cat) return -1; // TODO: return error code
+
+  task_T *head = parent ? &parent->child : &cat->tasks;
+  taskLinkBetween(task, head, prev, prev ? prev->rlink : *head);
+  task->parent = parent;
+
+  taskSet(task, slot_keys[LS_PARENTID],
+    parent ? listTaskGet(list, parent, LS_ID) : "");
+  listMarkUpdate(list, task);
+  taskChanged(list, task);
+
+  taskPropagateCounts(list, task, task->nsubtasks + taskIsCounted(task),
+    task->nopen + taskIsOpen(task));
+
+  return taskPlaceBetween(list, task, head);
+}
+
+int
+listIndentTask(list_T list, task_T task)
+{
+  if (!(list && task)) return TD_INVALIDARG;
+
+  task_T parent = task->llink;
+  for ( ; parent && !taskIsShown(parent); parent=parent->llink) ;
+  if (!parent) return TD_INVALIDARG;
+
+  task_T prev = parent->child;
+  for ( ; prev && prev->rlink; prev=prev->rlink) ;
+
+  return listMoveSubtree(list, task, parent, prev, NULL);
+}
+
+int
+listOutdentTask(list_T list, task_T task)
+{
+  if (!(list && task && task->parent)) return TD_INVALIDARG;
+
+  return listMoveSubtree(list, task, task->parent->parent, task->parent, NULL);
+}
+
+int
+listSetTask(list_T list, task_T task)
+{
+  if (taskConform(task, list->keys, list->nkeys) != TD_OK)
+    return -1; // TODO: return error code
+
+  // Tasks built outside the list, e.g., while editing, keep their
+  // fields on the heap until they're set
+  if (taskSetArena(task, list->arena) != TD_OK)
+    return -1; // TODO: return error code
+
+  int updated = taskGetFlag(task, TF_UPDATE);
+  taskUnsetFlag(task, TF_UPDATE);
+
+  journalBegin(list);
+
+  // First check if the task current exists
+  task_T old = listFindTaskById(list, task->id);
+  if (old) {
+    const char *old_pos = taskPosition(list, old);
+    const char *pos = taskPosition(list, task);
+
+    int new_placement = old->parent_id != task->parent_id ||
+      strcmp(listTaskGet(list, old, LS_CATEGORY),
+      listTaskGet(list, task, LS_CATEGORY)) ||
+      (old_pos != pos && !(old_pos && pos && strcmp(old_pos, pos) == 0));
+
+    if (new_placement) {
+      journalLink(list, old);
+      listPopTask(list, old); // TODO: check for error
+    }
+
+    journalChanges(list, old, task);
+
+    int counted = taskIsCounted(old), open = taskIsOpen(old);
+
+    listMarkUpdate(list, old);
+    taskSwap(old, task);
+    task = old;
+
+    // If we have to adjust the placement of the task,
+    // then we let it fall through to the next section
+    if (!(new_placement)) {
+      counted = taskIsCounted(task) - counted;
+      open = taskIsOpen(task) - open;
+      if (counted || open) journalCounts(list, task, counted, open, 0);
+      taskPropagateCounts(list, task, counted, open);
+      taskChanged(list, task);
+      return TD_OK;
+    }
+  }
+
+  // The task is indexed before it's linked, so that it isn't left in the
+  // tree without being found by id. A task that's moved was taken out by
+  // listPopTask, so putting it back can't fail
+  if (idIndexPut(&list->index, task) != TD_OK) {
+    if (updated) taskSetFlag(task, TF_UPDATE);
+    return -1; // TODO: return error code
+  }
+
+  if (!old) journalLink(list, task);
+
+  // If it doesn't check for an existing parent
+  cat_T cat = getCategory(list, listTaskGet(list, task, LS_CATEGORY));
+  task_T parent = listFindTaskById(list, task->parent_id);
+
+  if (parent) {
+    taskLinkSibling(list, task, &parent->child);
+    task->parent = parent;
+
+  // Otherwise, set as a new task
+  } else taskLinkSibling(list, task, &cat->tasks);
+
+  if (task->id > list->maxid) list->maxid = task->id;
+  task->linked = 1;
+
+  taskPropagateCounts(list, task, task->nsubtasks + taskIsCounted(task),
+    task->nopen + taskIsOpen(task));
+  list->ntasks++;
+
+  if (updated) listMarkUpdate(list, task);
+  taskChanged(list, task);
+  
+  return TD_OK;
+}
+
+static void
+taskUnlink(task_T task)
+{
+  if (task->llink) task->llink->rlink = task->rlink;
+  else if (task->parent) task->parent->child = task->rlink;
+  if (task->rlink) task->rlink->llink = task->llink;
+
+  task->parent = task->llink = task->rlink = NULL;
+}
+
+int
+listBulkLoad(list_T list, task_T *tasks, const int ntasks)
+{
+  if (!(list && (tasks || ntasks == 0))) return TD_INVALIDARG;
+
+  task_T task;
+  viewsReset(list);
+  columnsReset(list);
+
+  // First pass: index the tasks by id. Completed tasks are indexed too,
+  // so that their subtasks aren't mistaken for orphans. If an id is
+  // already taken, the index keeps the first task and the later one
+  // is set with listSetTask at the end, replacing it
+  int i;
+  for (i=0; i < ntasks; i++) {
+    task = tasks[i];
+
+    if (taskConform(task, list->keys, list->nkeys) != TD_OK) break;
+    if (taskSetArena(task, list->arena) != TD_OK) break;
+
+    if (!idIndexGet(&list->index, task->id) &&
+        idIndexPut(&list->index, task) != TD_OK) break;
+  }
+
+  // The tasks indexed before one failed are taken out again, so the list
+  // doesn't find tasks that aren't in it
+  if (i < ntasks) {
+    for (int j=0; j < i; j++)
+      if (idIndexGet(&list->index, tasks[j]->id) == tasks[j])
+        idIndexRemove(&list->index, tasks[j]);
+    return -1; // TODO: return error code
+  }
+
+  // Second pass: link each task under its parent, or at the top of its
+  // category. Tasks are prepended in the order given, as with listSetTask
+  for (int i=0; i < ntasks; i++) {
+    task = tasks[i];
+    if (taskGetStatus(task) == TS_COMPLETE) continue;
+    if (task->id != TASK_NOID && idIndexGet(&list->index, task->id) != task)
+      continue;
+
+    cat_T cat = getCategory(list, listTaskGet(list, task, LS_CATEGORY));
+    if (!cat) return -1; // TODO: return error code
+
+    task_T parent = idIndexGet(&list->index, task->parent_id);
+
+    // Subtasks of completed tasks move to the top, as they always have
+    if (parent && taskGetStatus(parent) == TS_COMPLETE) parent = NULL;
+
+    else if (parent == task) {
+      fprintf(stderr, "Warning: task %d is its own parent, "
+        "so it was placed at the top of its category\n", task->id);
+      parent = NULL;
+
+    } else if (!parent && task->parent_id != TASK_NOID) {
+      fprintf(stderr, "Warning: parent %d of task %d doesn't exist, "
+        "so the task was placed at the top of its category\n", 
+        task->parent_id, task->id);
+    }
+
+    task_T *head = parent ? &parent->child : &cat->tasks;
+    if (*head) (*head)->llink = task;
+    task->rlink = *head;
+    task->llink = NULL;
+    task->parent = parent;
+    *head = task;
+
+    // Marks the task as not yet reached by the third pass
+    task->level = -1;
+    task->linked = 1;
+
+    if (task->id > list->maxid) list->maxid = task->id;
+    list->ntasks++;
+
+    if (taskGetFlag(task, TF_UPDATE)) {
+      taskUnsetFlag(task, TF_UPDATE);
+      listMarkUpdate(list, task);
+    }
+  }
+
+  // Third pass: set levels and subtask counts down from the top of each
+  // category. Any task that isn't reached is in a cycle of parents or
+  // below one
+  cat_T cat = NULL;
+  while ((cat = listGetCat(list, cat))) {
+    cat->ntasks = cat->nopen = 0;
+    for (task=cat->tasks; task; task=task->rlink) {
+      taskSetSubtree(task, 0);
+      cat->ntasks += task->nsubtasks + taskIsCounted(task);
+      cat->nopen += task->nopen + taskIsOpen(task);
+    }
+  }
+
+  for (int i=0; i < ntasks; i++) {
+    task = tasks[i];
+    if (task->level >= 0 || taskGetStatus(task) == TS_COMPLETE) continue;
+    if (task->id != TASK_NOID && idIndexGet(&list->index, task->id) != task)
+      continue;
+
+    // Climbing from the task, marking the tasks passed, reaches the cycle
+    // at the first task passed twice. The cycle is broken by moving that
+    // task to the top of its category, which reaches every task passed
+    task_T node = task;
+    for ( ; node->level == -1; node=node->parent) node->level = -2;
+
+    fprintf(stderr, "Warning: task %d is its own ancestor, "
+      "so it was placed at the top of its category\n", node->id);
+
+    cat = getCategory(list, listTaskGet(list, node, LS_CATEGORY));
+    taskUnlink(node);
+    if (cat->tasks) cat->tasks->llink = node;
+    node->rlink = cat->tasks;
+    cat->tasks = node;
+    taskSetSubtree(node, 0);
+    cat->ntasks += node->nsubtasks + taskIsCounted(node);
+    cat->nopen += node->nopen + taskIsOpen(node);
+  }
+
+  // Branch counts are summed from the counts of each category
+  for (cat=list->cat; cat; cat=cat->link) cat->nbranch_open = 0;
+  for (cat=list->cat; cat; cat=cat->link)
+    for (cat_T node=cat; node; node=node->parent)
+      node->nbranch_open += cat->nopen;
+
+  // Finally, drop the completed tasks and set the duplicates
+  for (int i=0; i < ntasks; i++)
+    if (taskGetStatus(tasks[i]) == TS_COMPLETE) {
+      idIndexRemove(&list->index, tasks[i]);
+      taskFree(&tasks[i]);
+    }
+
+  for (int i=0; i < ntasks; i++) {
+    task = tasks[i];
+    if (task && task->id != TASK_NOID &&
+        idIndexGet(&list->index, task->id) != task &&
+        listSetTask(list, task) != TD_OK)
+      return -1; // TODO: return error code
+  }
+
+  return TD_OK;
+}
+
+task_T
+listCloneSubtree(list_T list, const task_T task, task_T parent, 
+  const char *category)
+{
+  if (!(list && task)) return NULL;
+  if (list->slots[LS_ID] < 0) return NULL;
+  if (taskGetFlag(task, TF_COMPLETE) || taskGetFlag(task, TF_DELETE))
+    return NULL;
+
+  if (parent) category = listTaskGet(list, parent, LS_CATEGORY);
+  else if (!category) category = listTaskGet(list, task, LS_CATEGORY);
+
+  cat_T cat = getCategory(list, category);
+  if (!cat) return NULL;
+
+  // copies[d] is the last copy made d levels below task. The copies are
+  // linked to each other as they're made but aren't added to the list
+  // until they've all been made, so that the walk never sees them and a
+  // failure leaves the list as it was
+  int copies_len = 16;
+  task_T *copies = memCalloc(copies_len, sizeof(task_T));
+  if (!copies) return NULL;
+
+  int base = parent ? taskGetLevel(parent) + 1 : 0, n = 0, failed = 0;
+  int maxid = list->maxid;
+  char id[16]; // holds a 15 digit int
+
+  struct taskIter it;
+  taskIterInit(&it, task);
+
+  task_T src;
+  while ((src = taskIterNext(&it))) {
+
+    if (taskGetFlag(src, TF_COMPLETE) || taskGetFlag(src, TF_DELETE)) {
+      taskIterSkip(&it);
+      continue;
+    }
+
+    int depth = it.depth;
+    if (depth + 1 >= copies_len) {
+      task_T *ptr = memResize(copies, (copies_len << 1) * sizeof(task_T));
+      if (!ptr) { failed = 1; break; }
+      copies = ptr;
+      copies_len <<= 1;
+    }
+
+    task_T copy = listNewTask(list);
+    if (!copy) { failed = 1; break; }
+
+    elem_T elem = NULL;
+    while ((elem = taskNextElem(src, elem)))
+      taskSet(copy, elemKey(elem), elemVal(elem));
+
+    snprintf(id, sizeof(id), "%d", ++list->maxid);
+    taskSet(copy, slot_keys[LS_ID], id);
+
+    if (list->slots[LS_CATEGORY] >= 0)
+      taskSet(copy, slot_keys[LS_CATEGORY], category);
+
+    if (depth == 0) {
+      if (list->slots[LS_PARENTID] >= 0)
+        taskSet(copy, slot_keys[LS_PARENTID], 
+          parent ? listTaskGet(list, parent, LS_ID) : "");
+
+    } else {
+      task_T up = copies[depth-1];
+      if (list->slots[LS_PARENTID] >= 0)
+        taskSet(copy, slot_keys[LS_PARENTID], listTaskGet(list, up, LS_ID));
+
+      // Any copy at this depth made since up is one of its children
+      task_T prev = up->child ? copies[depth] : NULL;
+      if (prev) {
+        prev->rlink = copy;
+        copy->llink = prev;
+      } else up->child = copy;
+      copy->parent = up;
+
+      // The copies are given positions in the order they're made, since
+      // the tasks they copy might not have them
+      char pos[POSITION_LEN];
+      if (list->slots[LS_POSITION] >= 0 && positionBetween(pos, sizeof(pos),
+          taskPosition(list, prev), NULL) == TD_OK)
+        taskSet(copy, slot_keys[LS_POSITION], pos);
+    }
+
+    copies[depth] = copy;
+    n++;
+  }
+
+  task_T root = copies[0];
+  memFree(copies);
+
+  // A partial copy is taken apart from its first leaf up, and its ids
+  // are given back
+  if (failed) {
+    task_T copy = root, next;
+    for ( ; copy; copy=next) {
+      if (copy->child) { next = copy->child; continue; }
+      next = copy->rlink ? copy->rlink : copy->parent;
+      if (copy->parent) copy->parent->child = copy->rlink;
+      taskFree(&copy);
+    }
+    list->maxid = maxid;
+    return NULL; // TODO: return error code
+  }
+  if (!root) return NULL;
+
+  // The copies are undone along with the root, which is new to the list
+  journalBegin(list);
+  journalLink(list, root);
+
+  taskIterInit(&it, root);
+  for (task_T copy; (copy = taskIterNext(&it)); ) {
+    taskSetFlag(copy, TF_NEW);
+    listMarkUpdate(list, copy);
+    idIndexPut(&list->index, copy); // TODO: check for error
+    copy->linked = 1;
+    taskChanged(list, copy);
+  }
+
+  // Only root is positioned among the tasks already there. The copies
+  // below it have the positions they were given as they were made
+  taskLinkFirst(list, root, parent ? &parent->child : &cat->tasks);
+  root->parent = parent;
+
+  // None of the copies are complete
+  taskSetSubtree(root, base);
+  taskPropagateCounts(list, root, n, n);
+  list->ntasks += n;
+
+  return root;
+}
+
+int
+listAddKey(list_T list, const char *key)
+{
+  if (list->nkeys >= list->keys_len) {
+    list->keys_len <<= 1;
+    const char **ptr = memResize(list->keys, list->keys_len * sizeof(char *));
+    if (!ptr) return -1; // TODO: return error code
+    else list->keys = ptr;
+  }
+
+  const char *atom = atomString(key);
+  if (!atom) return -1; // TODO: return error code
+
+  for (int i=0; i < LS_NSLOTS; i++)
+    if (atomString(slot_keys[i]) == atom) list->slots[i] = list->nkeys;
+
+  list->keys[list->nkeys++] = atom;
+  columnsReset(list);
+
+  return TD_OK;
+}
+
+char *
+listName(const list_T list)
+{
+  if (!list) return NULL;
+  else return list->name;
+}
+
+long
+listSize(const list_T list)
+{
+  if (!list) return 0;
+
+  long size = arenaSize(list->arena) + list->keys_len * sizeof(char *) +
+    list->index.len * sizeof(task_T) + list->cat_index_len * sizeof(cat_T);
+
+  for (view_T view=list->views; view; view=view->link)
+    size += view->tasks.len * sizeof(task_T);
+
+  struct columns *columns = list->columns;
+  if (columns && columns->built) {
+    size += arenaSize(columns->arena) + columns->rows_len * sizeof(task_T);
+    for (int i=0; i < columns->ncols; i++)
+      size += columns->rows_len * sizeof(int) +
+        columns->cols[i].vals_len * sizeof(char *) +
+        columns->cols[i].hash_len * sizeof(int);
+  }
+
+  return size;
+}
+
+int
+listNumKeys(const list_T list)
+{
+  if (!list) return TD_INVALIDARG;
+  else return list->nkeys;
+}
+
+// TODO: make this interface consistent with the other ones
+const char **
+listGetKeys(const list_T list)
+{
+  if (!list) return NULL;
+  else return list->keys;
+}
+
+int
+listContainsKey(const list_T list, const char *key)
+{
+  return listKeySlot(list, key) >= 0;
+}
+
+int
+listKeySlot(const list_T list, const char *key)
+{
+  if (!(list && key)) return -1;
+
+  const char *atom = atomString(key);
+  for (int i=0; i < list->nkeys; i++)
+    if (list->keys[i] == atom)
+      return i;
+
+  return -1;
+}
+  
+cat_T
+listGetCat(const list_T list, const cat_T cat)
+{
+  if (!list) return NULL;
+  else if (!cat) return list->cat;
+  else return cat->link;
+}
+
+cat_T
+listNextCat(const list_T list, const cat_T cat, const int skip, int *depth)
+{
+  if (!(list && depth)) return NULL;
+
+  if (!cat) {
+    *depth = 0;
+    return list->cat_tree;
+  }
+
+  if (!skip && cat->child) {
+    (*depth)++;
+    return cat->child;
+  }
+
+  cat_T node = cat;
+  for ( ; node && !node->sibling; node=node->parent) (*depth)--;
+
+  return node ? node->sibling : NULL;
+}
+
+int
+listNumUpdates(const list_T list)
+{
+  if (!list) return 0;
+  else return list->nupdates;
+}
+
+task_T *
+listGetUpdates(const list_T list)
+{
+
+  if (!list->nupdates) return NULL;
+
+  int n = 0;
+  task_T task;
+  for (task=list->dirty; task; task=task->dirty) n++;
+
+  task_T *updates = memCalloc(n + 1, sizeof(task_T));
+  if (!updates) return NULL;
+
+  // The most recent update is first, so fill from the end
+  for (task=list->dirty; task; task=task->dirty) updates[--n] = task;
+
+  return updates;
+}
+
+int
+listClearUpdates(list_T list)
+{
+  task_T task, next;
+  for (task=list->dirty; task; task=next) {
+    next = task->dirty;
+    // Once saved, a new task is updated rather than inserted again
+    task->flags &= ~(TF_NEW | TF_UPDATE);
+    task->dirty = NULL;
+  }
+
+  list->dirty = NULL;
+  list->nupdates = 0;
+  journalClear(list);
+
+  return TD_OK;
+}
+
+/**
+ * Whether task and all of its subtasks are complete or deleted and have
+ * no unsaved updates, so that nothing is lost by dropping them
+ */
+static int
+taskIsCompactable(const task_T task)
+{
+  if (taskIsOpen(task) || task->nopen > 0) return 0;
+
+  struct taskIter it;
+  taskIterInit(&it, task);
+
+  task_T node;
+  while ((node = taskIterNext(&it)))
+    if (taskGetFlag(node, TF_UPDATE)) return 0;
+
+  return 1;
+}
+
+/**
+ * Pops task from the list and frees it along with its subtasks. Each
+ * leaf is freed before its parent, so the walk never reads a freed task
+ */
+static void
+listDropSubtree(list_T list, task_T task)
+{
+  listPopTask(list, task);
+
+  task_T node = task;
+  while (node) {
+    if (node->child) {
+      node = node->child;
+      continue;
+    }
+
+    task_T up = node == task ? NULL : node->parent;
+    if (up) {
+      up->child = node->rlink;
+      idIndexRemove(&list->index, node);
+      list->ntasks--;
+    }
+
+    taskFree(&node);
+    node = up;
+  }
+}
+
+int
+listCompact(list_T list)
+{
+  if (!list) return TD_INVALIDARG;
+
+  // The history may hold tasks that are dropped
+  journalClear(list);
+
+  // Values only dropped tasks had are left out when the columns are
+  // filled again
+  columnsReset(list);
+
+  cat_T cat, next;
+  for (cat=list->cat; cat; cat=next) {
+    // The category is unlinked if all its tasks are dropped
+    next = cat->link;
+
+    struct taskIter it;
+    catIterInit(&it, cat);
+
+    task_T task = taskIterNext(&it);
+    while (task) {
+      if (!taskIsCompactable(task)) {
+        task = taskIterNext(&it);
+        continue;
+      }
+
+      // Step past the subtree before it's freed
+      taskIterSkip(&it);
+      task_T after = taskIterNext(&it);
+      listDropSubtree(list, task);
+      task = after;
+    }
+  }
+
+  return TD_OK;
+}
+
+/**
+ * Applies op to task, and for LO_COMPLETE and LO_DELETE to the tasks
+ * below it, in one walk of the subtree. The counts of the ancestors and
+ * category are adjusted once for the whole subtree
+ */
+static void
+taskApply(list_T list, task_T task, const int op, const char *key, 
+  const char *val)
+{
+  if (taskGetFlag(task, TF_DELETE)) return;
+
+  if (op == LO_SET) {
+    journalField(list, task, key);
+    taskSet(task, key, val);
+    listMarkUpdate(list, task);
+    taskChanged(list, task);
+    return;
+  }
+
+  // Already covered, e.g., by a selected ancestor
+  if (op == LO_COMPLETE && !taskIsOpen(task) && task->nopen == 0) return;
+
+  int ntasks = op == LO_DELETE ? -(task->nsubtasks + taskIsCounted(task)) : 0;
+  int nopen = -(task->nopen + taskIsOpen(task));
+  journalCounts(list, task, ntasks, nopen, 1);
+  taskPropagateCounts(list, task, ntasks, nopen);
+
+  task_T root = task;
+  struct taskIter it;
+  taskIterInit(&it, task);
+
+  while ((task = taskIterNext(&it))) {
+    // Nothing below the task is open anymore, or counted once deleted
+    task->nopen = 0;
+
+    if (op == LO_COMPLETE) {
+      if (taskGetFlag(task, TF_DELETE)) {
+        taskIterSkip(&it);
+        continue;
+      }
+
+      journalField(list, task, "status");
+      journalFlags(list, task);
+      taskSet(task, "status", "Complete");
+      listMarkUpdate(list, task);
+      taskSetFlag(task, TF_COMPLETE);
+      taskChanged(list, task);
+      continue;
+    }
+
+    task->nsubtasks = 0;
+    journalFlags(list, task);
+
+    // A new task that's deleted before it's saved has nothing to write,
+    // but it stays in the updates, which undo walks, so the backends skip it
+    listMarkUpdate(list, task);
+    taskSetFlag(task, TF_DELETE);
+    taskChanged(list, task);
+  }
+
+  journalCounts(list, root, 0, 0, 1);
+}
+
+int
+listApply(list_T list, task_T *tasks, const int ntasks, const int op,
+  const char *key, const char *val)
+{
+  if (!(list && (tasks || ntasks == 0))) return TD_INVALIDARG;
+
+  switch (op) {
+  case LO_SET: ;
+    // Fields that place or count the task are changed by other means
+    int slot = listKeySlot(list, key);
+    if (slot < 0) return TD_INVALIDARG;
+    for (int i=0; i < LS_NSLOTS; i++)
+      if (list->slots[i] == slot) return TD_INVALIDARG;
+    break;
+
+  case LO_COMPLETE:
+  case LO_DELETE:
+    break;
+
+  default:
+    return TD_INVALIDARG;
+  }
+
+  journalBegin(list);
+  for (int i=0; i < ntasks; i++)
+    if (tasks[i]) taskApply(list, tasks[i], op, key, val);
+
+  return TD_OK;
+}
+
+int 
+markComplete(list_T list, task_T task)
+{
+  if (!task) return TD_INVALIDARG;
+  else return listApply(list, &task, 1, LO_COMPLETE, NULL, NULL);
+}
+
+int 
+markDelete(list_T list, task_T task)
+{
+  if (!task) return TD_INVALIDARG;
+  else return listApply(list, &task, 1, LO_DELETE, NULL, NULL);
+}
+  
+int
 listGetMaxId(const list_T list)
 {
   if (!list) return TD_INVALIDARG;
   else return list->maxid;
 }
+
+// -----------------------------------------------------------------------------
+// Undo
+// -----------------------------------------------------------------------------
+
+static void
+journalSwapField(list_T list, struct journalItem *item)
+{
+  char *val = journalCopy(taskGet(item->task, item->key));
+  taskSet(item->task, item->key, item->val ? item->val : "");
+  free(item->val);
+  item->val = val;
+
+  taskChanged(list, item->task);
+}
+
+// Whether a task is marked as updated is left to the step
+static void
+journalSwapFlags(list_T list, struct journalItem *item)
+{
+  task_T task = item->task;
+  int flags = task->flags & ~TF_UPDATE;
+  task->flags = item->flags | (task->flags & TF_UPDATE);
+  item->flags = flags;
+
+  taskChanged(list, task);
+}
+
+static void
+journalSwapCounts(list_T list, struct journalItem *item)
+{
+  task_T task = item->task;
+  if (item->recount) taskSetSubtree(task, taskGetLevel(task));
+
+  taskPropagateCounts(list, task, -item->ntasks, -item->nopen);
+  item->ntasks = -item->ntasks;
+  item->nopen = -item->nopen;
+}
+
+/**
+ * Moves task back to where the item has it, or takes it out of the list
+ * if it wasn't in it, along with its subtasks
+ */
+static void
+journalSwapLink(list_T list, struct journalItem *item)
+{
+  task_T task = item->task;
+  int linked = taskIsLinked(task);
+  task_T parent = task->parent, prev = task->llink;
+  const char *category = atomString(listTaskGet(list, task, LS_CATEGORY));
+  char *parent_id = journalCopy(listTaskGet(list, task, LS_PARENTID));
+
+  if (linked) taskDetach(list, task);
+
+  if (linked != item->linked) {
+    struct taskIter it;
+    taskIterInit(&it, task);
+
+    task_T node;
+    int n = 0;
+    while ((node = taskIterNext(&it))) {
+      if (linked) idIndexRemove(&list->index, node);
+      else idIndexPut(&list->index, node); // TODO: check for error
+      node->linked = !linked;
+      taskChanged(list, node);
+      n++;
+    }
+
+    list->ntasks += linked ? -n : n;
+  }
+
+  if (item->linked) {
+    taskSet(task, slot_keys[LS_CATEGORY], item->category);
+    taskSet(task, slot_keys[LS_PARENTID], item->val ? item->val : "");
+
+    cat_T cat = getCategory(list, item->category);
+    task_T *head = item->parent ? &item->parent->child : &cat->tasks;
+    taskLinkBetween(task, head, item->prev, 
+      item->prev ? item->prev->rlink : *head);
+    task->parent = item->parent;
+
+    taskPropagateCounts(list, task, task->nsubtasks + taskIsCounted(task),
+      task->nopen + taskIsOpen(task));
+  }
+
+  taskChanged(list, task);
+
+  free(item->val);
+  item->linked = linked;
+  item->parent = parent;
+  item->prev = prev;
+  item->category = category;
+  item->val = parent_id;
+}
+
+static void
+journalSwap(list_T list, struct journalItem *item)
+{
+  switch (item->type) {
+  case JI_FIELD:  journalSwapField(list, item); break;
+  case JI_FLAGS:  journalSwapFlags(list, item); break;
+  case JI_COUNTS: journalSwapCounts(list, item); break;
+  case JI_LINK:   journalSwapLink(list, item); break;
+  }
+}
+
+int
+listSetHistory(list_T list, const int depth)
+{
+  if (!list || depth < 0) return TD_INVALIDARG;
+
+  journalFree(list);
+  if (depth == 0) return TD_OK;
+
+  struct journal *journal = memCalloc(1, sizeof(*journal));
+  if (!journal) return -1; // TODO: return error code
+
+  journal->undo = memCalloc(depth, sizeof(*journal->undo));
+  journal->redo = memCalloc(depth, sizeof(*journal->redo));
+  journal->depth = depth;
+  list->journal = journal;
+
+  if (!(journal->undo && journal->redo)) {
+    journalFree(list);
+    return -1; // TODO: return error code
+  }
+
+  return TD_OK;
+}
+
+int
+listUndo(list_T list)
+{
+  if (!(list && list->journal && list->journal->nundo)) return TD_INVALIDARG;
+
+  struct journal *journal = list->journal;
+  struct journalStep *step = journal->undo[--journal->nundo];
+
+  // The tasks the step marked are the ones updated since it began. They're
+  // kept, oldest last, so that redoing the step marks them again
+  int n = 0;
+  task_T task;
+  for (task=list->dirty; task && task != step->dirty; task=task->dirty) n++;
+
+  step->marked = n ? memCalloc(n, sizeof(task_T)) : NULL;
+  if (n && !step->marked) {
+    journalFreeStep(step);
+    journalClear(list);
+    return -1; // TODO: return error code
+  }
+
+  step->nmarked = n;
+  for (int i=0; i < n; i++) {
+    task = list->dirty;
+    list->dirty = task->dirty;
+    task->dirty = NULL;
+    taskUnsetFlag(task, TF_UPDATE);
+    step->marked[i] = task;
+  }
+
+  for (int i=step->nitems-1; i >= 0; i--) journalSwap(list, &step->items[i]);
+
+  int nupdates = list->nupdates;
+  list->nupdates = step->nupdates;
+  step->nupdates = nupdates;
+
+  journal->redo[journal->nredo++] = step;
+
+  return TD_OK;
+}
+
+int
+listRedo(list_T list)
+{
+  if (!(list && list->journal && list->journal->nredo)) return TD_INVALIDARG;
+
+  struct journal *journal = list->journal;
+  struct journalStep *step = journal->redo[--journal->nredo];
+
+  for (int i=0; i < step->nitems; i++) journalSwap(list, &step->items[i]);
+
+  for (int i=step->nmarked-1; i >= 0; i--) {
+    task_T task = step->marked[i];
+    taskSetFlag(task, TF_UPDATE);
+    task->dirty = list->dirty;
+    list->dirty = task;
+  }
+
+  memFree(step->marked);
+  step->marked = NULL;
+  step->nmarked = 0;
+
+  int nupdates = list->nupdates;
+  list->nupdates = step->nupdates;
+  step->nupdates = nupdates;
+
+  journal->undo[journal->nundo++] = step;
+
+  return TD_OK;
+}
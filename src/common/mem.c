@@ -20,6 +20,7 @@
 
 #include <stdlib.h>
 #include <stddef.h>
+#include <string.h> // memset, memcpy, strlen
 #include "mem.h"
 
 void *
@@ -49,4 +50,167 @@ memResize(void *ptr, long nbytes)
   return realloc(ptr, nbytes);
 }
 
+// -----------------------------------------------------------------------------
+// Arena
+// -----------------------------------------------------------------------------
+
+#define ARENA_BLOCK_LEN (64 * 1024) // minimum size of a block, in bytes
+#define ARENA_ALIGN     16          // alignment of every allocation
+#define ARENA_NCLASSES  32          // sizes up to this many ARENA_ALIGNs are
+                                    // reused once released
+
+struct block {
+  struct block *link; // previously filled block
+  long len;           // bytes available after the header
+  long used;          // bytes handed out
+  max_align_t data[];
+};
+
+/**
+ * Released allocations are kept in a free list for their size, rounded
+ * up to ARENA_ALIGN, and linked through their first word. Larger ones
+ * aren't reused until the arena is freed.
+ */
+struct arena_T {
+  struct block *head; // block currently being filled
+  long size;          // total bytes held in blocks
+  void *free[ARENA_NCLASSES]; // released allocations, by size class
+};
+
+arena_T
+arenaNew()
+{
+  return memCalloc(1, sizeof(struct arena_T));
+}
+
+static void
+arenaPush(arena_T arena, void *ptr, const long nbytes)
+{
+  int class = nbytes / ARENA_ALIGN - 1;
+  *(void **) ptr = arena->free[class];
+  arena->free[class] = ptr;
+}
+
+// What's left of the block goes to the free lists rather than to waste
+static void
+arenaReleaseTail(arena_T arena, struct block *block)
+{
+  long left = block->len - block->used;
+  while (left >= ARENA_ALIGN) {
+    long nbytes = left < ARENA_NCLASSES * ARENA_ALIGN
+      ? left : ARENA_NCLASSES * ARENA_ALIGN;
+    arenaPush(arena, (char *) block->data + block->used, nbytes);
+    block->used += nbytes;
+    left -= nbytes;
+  }
+}
+
+static struct block *
+arenaAddBlock(arena_T arena, const long len)
+{
+  struct block *block = memAlloc(sizeof(*block) + len);
+  if (!block) return NULL;
+
+  block->len = len;
+  block->used = 0;
+  arena->size += len;
+
+  return block;
+}
+
+void *
+arenaAlloc(arena_T arena, long nbytes)
+{
+  if (!arena || nbytes <= 0) return NULL;
+
+  nbytes = (nbytes + ARENA_ALIGN - 1) & ~(long) (ARENA_ALIGN - 1);
+
+  int class = nbytes / ARENA_ALIGN - 1;
+  if (class < ARENA_NCLASSES && arena->free[class]) {
+    void *ptr = arena->free[class];
+    arena->free[class] = *(void **) ptr;
+    return ptr;
+  }
+
+  struct block *block = arena->head;
+  if (!block || block->len - block->used < nbytes) {
+    // A large allocation gets a block of its own, behind the one being
+    // filled, which is kept
+    if (nbytes > ARENA_BLOCK_LEN / 4 && block) {
+      struct block *own = arenaAddBlock(arena, nbytes);
+      if (!own) return NULL;
+
+      own->used = nbytes;
+      own->link = block->link;
+      block->link = own;
+
+      return own->data;
+    }
 
+    long len = nbytes > ARENA_BLOCK_LEN ? nbytes : ARENA_BLOCK_LEN;
+    if (!(block = arenaAddBlock(arena, len))) return NULL;
+
+    if (arena->head) arenaReleaseTail(arena, arena->head);
+    block->link = arena->head;
+    arena->head = block;
+  }
+
+  void *ptr = (char *) block->data + block->used;
+  block->used += nbytes;
+
+  return ptr;
+}
+
+void
+arenaRelease(arena_T arena, void *ptr, long nbytes)
+{
+  if (!(arena && ptr) || nbytes <= 0) return;
+
+  nbytes = (nbytes + ARENA_ALIGN - 1) & ~(long) (ARENA_ALIGN - 1);
+  if (nbytes <= ARENA_NCLASSES * ARENA_ALIGN) arenaPush(arena, ptr, nbytes);
+}
+
+void *
+arenaCalloc(arena_T arena, long count, long nbytes)
+{
+  if (count <= 0 || nbytes <= 0) return NULL;
+
+  void *ptr = arenaAlloc(arena, count * nbytes);
+  if (ptr) memset(ptr, 0, count * nbytes);
+
+  return ptr;
+}
+
+char *
+arenaStrdup(arena_T arena, const char *str)
+{
+  if (!str) return NULL;
+
+  long len = strlen(str) + 1;
+  char *ptr = arenaAlloc(arena, len);
+  if (ptr) memcpy(ptr, str, len);
+
+  return ptr;
+}
+
+long
+arenaSize(const arena_T arena)
+{
+  if (!arena) return 0;
+  else return arena->size;
+}
+
+void
+arenaFree(arena_T *arena)
+{
+  if (!(arena && *arena)) return;
+
+  struct block *block, *link;
+  for (block=(*arena)->head; block; block=link) {
+    link = block->link;
+    free(block);
+  }
+
+  free(*arena);
+  *arena = NULL;
+}
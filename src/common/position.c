@@ -0,0 +1,223 @@
+//
+// -----------------------------------------------------------------------------
+// position.c
+// -----------------------------------------------------------------------------
+//
+// Copyright (c) 2022 Tyler Wayne
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <string.h>       // strlen, strcmp, strncmp, strcpy, strspn, memcpy
+#include <ctype.h>        // isdigit
+#include "return-codes.h" // TD_OK
+#include "position.h"
+
+// The integer part of a position is a letter followed by digits. Lower
+// case letters 'a' to 'z' are for 1 to 26 digits and count up, and upper
+// case letters 'Z' to 'A' are for 1 to 26 digits and count down, so that
+// ... < "Y99" < "Z0" < ... < "Z9" < "a0" < ... < "a9" < "b00" < ...
+
+struct out {
+  char  *buf;
+  size_t len;
+  size_t pos; // where the next char goes, which may be past len
+};
+
+static void
+put(struct out *out, const char *str, const size_t n)
+{
+  for (size_t i=0; i < n; i++, out->pos++)
+    if (out->pos < out->len) out->buf[out->pos] = str[i];
+}
+
+/**
+ * Returns the length of the integer part of a position from its first
+ * letter, or -1 if it isn't a letter
+ */
+static int
+intLen(const char head)
+{
+  if (head >= 'a' && head <= 'z') return head - 'a' + 2;
+  if (head >= 'A' && head <= 'Z') return 'Z' - head + 2;
+  return -1;
+}
+
+static int
+intIncrement(char *buf, const char *pos, const int len)
+{
+  if (len < 2) return TD_INVALIDARG;
+
+  memcpy(buf, pos, len);
+  buf[len] = '\0';
+
+  for (int i=len-1; i > 0; i--) {
+    if (buf[i] != '9') {
+      buf[i]++;
+      return TD_OK;
+    }
+    buf[i] = '0';
+  }
+
+  // All of the digits carried, so the number of digits changes
+  if (buf[0] == 'z') return TD_INVALIDARG;
+  if (buf[0] == 'Z') {
+    strcpy(buf, "a0");
+    return TD_OK;
+  }
+
+  buf[0]++;
+  if (buf[0] > 'a') strcpy(buf + len, "0");
+  else buf[len-1] = '\0';
+
+  return TD_OK;
+}
+
+static int
+intDecrement(char *buf, const char *pos, const int len)
+{
+  if (len < 2) return TD_INVALIDARG;
+
+  memcpy(buf, pos, len);
+  buf[len] = '\0';
+
+  for (int i=len-1; i > 0; i--) {
+    if (buf[i] != '0') {
+      buf[i]--;
+      return TD_OK;
+    }
+    buf[i] = '9';
+  }
+
+  // All of the digits borrowed, so the number of digits changes
+  if (buf[0] == 'A') return TD_INVALIDARG;
+  if (buf[0] == 'a') {
+    strcpy(buf, "Z9");
+    return TD_OK;
+  }
+
+  buf[0]--;
+  if (buf[0] < 'Z') strcpy(buf + len, "9");
+  else buf[len-1] = '\0';
+
+  return TD_OK;
+}
+
+/**
+ * Writes a fraction between the fractions lo and hi, where hi is NULL for
+ * one past any fraction. Fractions are compared digit by digit, so this
+ * takes time linear to their length
+ */
+static void
+fracBetween(struct out *out, const char *lo, const char *hi)
+{
+  size_t lo_len = strlen(lo);
+
+  if (hi) {
+    // Copy the digits they have in common, treating lo as padded by 0s
+    size_t n = 0;
+    while ((n < lo_len ? lo[n] : '0') == hi[n]) n++;
+    if (n > 0) {
+      put(out, hi, n);
+      fracBetween(out, n < lo_len ? lo + n : "", hi + n);
+      return;
+    }
+  }
+
+  int lo_digit = lo_len ? *lo - '0' : 0;
+  int hi_digit = hi ? *hi - '0' : 10;
+
+  if (hi_digit - lo_digit > 1) {
+    char mid = '0' + (lo_digit + hi_digit + 1) / 2;
+    put(out, &mid, 1);
+  } else if (hi && hi[1]) {
+    put(out, hi, 1);
+  } else {
+    char digit = '0' + lo_digit;
+    put(out, &digit, 1);
+    fracBetween(out, lo_len ? lo + 1 : "", NULL);
+  }
+}
+
+int
+positionIsValid(const char *pos)
+{
+  if (!pos) return 0;
+
+  int len = intLen(*pos);
+  size_t pos_len = strlen(pos);
+  if (len < 0 || pos_len < (size_t) len) return 0;
+
+  for (size_t i=1; i < pos_len; i++)
+    if (!isdigit((unsigned char) pos[i])) return 0;
+
+  // A fraction can't end in 0, or there would be no position between,
+  // e.g., "a5" and "a50"
+  if (pos_len > (size_t) len) return pos[pos_len-1] != '0';
+
+  // There has to be room for a position before any other
+  if (*pos == 'A' && strspn(pos + 1, "0") == pos_len - 1) return 0;
+
+  return 1;
+}
+
+int
+positionBetween(char *buf, const size_t len, const char *lo, const char *hi)
+{
+  if (!(buf && len)) return TD_INVALIDARG;
+  if ((lo && !positionIsValid(lo)) || (hi && !positionIsValid(hi)))
+    return TD_INVALIDARG;
+  if (lo && hi && strcmp(lo, hi) >= 0) return TD_INVALIDARG;
+
+  struct out out = { buf, len, 0 };
+  char num[POSITION_LEN];
+
+  if (!lo && !hi) put(&out, "a0", 2);
+
+  // Before hi, the integer part of hi if it has a fraction or else the
+  // integer before it
+  else if (!lo) {
+    int hi_len = intLen(*hi);
+    if (hi[hi_len]) put(&out, hi, hi_len);
+    else if (intDecrement(num, hi, hi_len) == TD_OK)
+      put(&out, num, strlen(num));
+    else return TD_INVALIDARG;
+
+  // After lo, the integer after it, unless lo is the largest integer
+  } else if (!hi) {
+    int lo_len = intLen(*lo);
+    if (intIncrement(num, lo, lo_len) == TD_OK) put(&out, num, strlen(num));
+    else {
+      put(&out, lo, lo_len);
+      fracBetween(&out, lo + lo_len, NULL);
+    }
+
+  // Between the two, an integer if there's one, or else a fraction
+  } else {
+    int lo_len = intLen(*lo), hi_len = intLen(*hi);
+    if (lo_len == hi_len && strncmp(lo, hi, lo_len) == 0) {
+      put(&out, lo, lo_len);
+      fracBetween(&out, lo + lo_len, hi + hi_len);
+    } else if (intIncrement(num, lo, lo_len) == TD_OK && strcmp(num, hi) < 0)
+      put(&out, num, strlen(num));
+    else {
+      put(&out, lo, lo_len);
+      fracBetween(&out, lo + lo_len, NULL);
+    }
+  }
+
+  put(&out, "", 1);
+  if (out.pos > len) return TD_BUFOVERFLOW;
+
+  return TD_OK;
+}
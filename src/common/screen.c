@@ -20,7 +20,7 @@
 
 #include <stdio.h>
 #include <stdlib.h> // free
-#include <string.h> // strdup
+#include <string.h> // strdup, strcmp
 #include "mem.h"
 #include "return-codes.h"
 #include "task.h"
@@ -62,64 +62,115 @@ screenAddLine(screen_T screen, const int type, void *obj, const int level, const
 
   screen->nlines++;
 
-  if (!screen->lines) {
-    screen->lines = line;
-    return TD_OK;
+  if (!screen->lines) screen->lines = line;
+  else {
+    screen->tail->rlink = line;
+    line->llink = screen->tail;
   }
+  screen->tail = line;
 
-  line_T tail = screen->lines;
-  for ( ; tail->rlink; tail=tail->rlink) ;
+  return TD_OK;
+}
 
-  tail->rlink = line;
-  line->llink = tail;
+/**
+ * This function traverses the task tree for a category and adds tasks
+ * and subtasks, one line each after lineno, indented below the category
+ * at level. Completed tasks aren't shown, and deleted tasks are pruned
+ * along with their subtasks. Returns the last line number used
+ */
+static int
+screenAddTasks(screen_T screen, const cat_T cat, const int level, int lineno)
+{
+  struct taskIter it;
+  catIterInit(&it, cat);
+
+  task_T task;
+  while ((task = taskIterNext(&it))) {
+    if (taskGetFlag(task, TF_DELETE)) {
+      taskIterSkip(&it);
+      continue;
+    }
+
+    if (taskGetStatus(task) != TS_COMPLETE) {
+      lineno++;
+      screenAddLine(screen, LT_TASK, task, level + it.depth + 1, lineno);
+    }
+  }
 
-  return TD_OK;
+  return lineno;
 }
 
+
 /**
- * This function recursively traverses the task tree for a category
- * and adds tasks and subtasks. It also includes a lineno. We wait
- * to see if a task is non-null, that is the parent task or previous
- * task was not a leaf, before incrementing the line count
+ * Adds the tasks of a saved view, each under a line for its category. The
+ * view keeps its tasks as they change, so the list isn't walked, and they
+ * aren't nested since the tasks they're under may not be in the view.
  */
 static int
-screenAddTasks(screen_T screen, const task_T task, const int level, int lineno)
+screenAddView(screen_T screen, const list_T list, const view_T view)
 {
-  // Skip NULL, completed, or deleted tasks
-  if (!task) return lineno; 
+  task_T *tasks = listViewGetTasks(list, view);
+  if (!tasks) return -1; // TODO: return error code
 
-  if (strcasecmp(taskGet(task, "status"), "Complete") != 0 &&
-      !taskGetFlag(task, TF_DELETE)) {
-    lineno++;
-    screenAddLine(screen, LT_TASK, task, level, lineno);
+  int lineno = 0;
+  const char *category = NULL;
+  for (int i=0; tasks[i]; i++) {
+    const char *name = taskGet(tasks[i], "category");
+    if (!category || strcmp(category, name ? name : "")) {
+      category = name ? name : "";
+
+      // Tasks whose category the list doesn't have go without a header
+      cat_T cat = listFindCat(list, category);
+      if (cat) {
+        // Blank line between categories
+        if (screen->nlines > 0) {
+          lineno++;
+          screen->nlines++;
+        }
+
+        screenAddLine(screen, LT_CAT, cat, 0, lineno++);
+      }
+    }
+
+    screenAddLine(screen, LT_TASK, tasks[i], 1, lineno++);
   }
 
-  lineno = screenAddTasks(screen, taskGetSubtask(task), level+1, lineno); 
-  return screenAddTasks(screen, taskGetNext(task), level, lineno); 
-}
+  memFree(tasks);
 
+  return TD_OK;
+}
 
+/**
+ * Categories are added by nesting, each indented below the one it's in.
+ * A category without open tasks in its branch, or one that's folded,
+ * isn't walked into, so hidden branches cost nothing to pass over.
+ */
 int
 screenInitialize(screen_T screen, const list_T list)
 {
+  if (screen->view) return screenAddView(screen, list, screen->view);
+
   cat_T cat = NULL;
-  int lineno = 0;
-  while ((cat = listGetCat(list, cat))) {
-    if (catNumOpen(cat) <= 0) continue;
+  int lineno = 0, depth = 0, skip = 0;
+  while ((cat = listNextCat(list, cat, skip, &depth))) {
+    skip = catNumBranchOpen(cat) <= 0 || catIsFolded(cat);
+    if (catNumBranchOpen(cat) <= 0) continue;
 
-    screenAddLine(screen, LT_CAT, cat, 0, lineno);
+    // Blank line between top-level categories
+    if (depth == 0 && screen->nlines > 0) {
+      lineno++;
+      screen->nlines++;
+    }
 
-    task_T task = catGetTask(cat, NULL);
-    if (!task) return -1; // TODO: return error code
+    screenAddLine(screen, LT_CAT, cat, depth, lineno);
 
-    // Increment once to bring it to the current line
-    // and a second time to add a blank line
-    lineno = screenAddTasks(screen, task, 1, lineno) + 2;
-    screen->nlines++; // Blank line
-  }
+    if (!skip && catNumOpen(cat) > 0) {
+      if (!catGetTask(cat, NULL)) return -1; // TODO: return error code
+      lineno = screenAddTasks(screen, cat, depth, lineno);
+    }
 
-  // Remove the trailing blank line
-  screen->nlines--;
+    lineno++;
+  }
 
   return TD_OK;
 }
@@ -130,14 +181,17 @@ int
 screenReset(screen_T *screen, const list_T list)
 {
   int offset = 0; // save the offset
+  view_T view = NULL;
 
   if (screen && *screen) {
     offset = (*screen)->offset;
+    view = (*screen)->view;
     screenFree(screen);
   }
 
   *screen = screenNew();
   (*screen)->offset = offset;
+  (*screen)->view = view;
   
   return screenInitialize(*screen, list);
 }
@@ -154,6 +208,20 @@ screenGetLine(const screen_T screen, const int lineno)
   else return NULL;
 }
 
+/**
+ * Returns the line showing obj, e.g., a task, or NULL if it isn't shown
+ */
+line_T
+screenFindLine(const screen_T screen, const void *obj)
+{
+  if (!(screen && obj)) return NULL;
+
+  line_T line = screen->lines;
+  for ( ; line && line->obj != obj; line = line->rlink) ;
+
+  return line;
+}
+
 line_T
 screenGetFirstLine(const screen_T screen)
 {
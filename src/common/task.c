@@ -19,10 +19,13 @@
 //
 
 #include <stdio.h>        // sscanf
-#include <stdlib.h>       // calloc, free
-#include <string.h>       // strdup
+#include <stdlib.h>       // calloc, free, strtol
+#include <stdint.h>       // uintptr_t
+#include <string.h>       // strlen, strcasecmp, memcpy, memset
 #include <stdbool.h>      // bool, true, false
-#include "mem.h"          // memCalloc, memFree
+#include <limits.h>       // INT_MAX
+#include "mem.h"          // memCalloc, memFree, arenaAlloc, arenaRelease
+#include "atom.h"         // atomString, atomFind
 #include "return-codes.h" // TD_OK
 #include "task.h"
 
@@ -36,24 +39,310 @@ static char *required_keys[] = {
   NULL
 };
 
+static const char **interned_keys = NULL;
+static int ninterned = 0;
+static int interned_len = 0;
+
+int
+taskInternKey(const char *key)
+{
+  if (!(key && *key)) return TD_INVALIDARG;
+
+  const char *atom = atomString(key);
+  if (!atom) return -1; // TODO: return error code
+  if (taskKeyIsInterned(atom)) return TD_OK;
+
+  if (ninterned >= interned_len) {
+    int len = interned_len ? interned_len << 1 : 8;
+    const char **keys = interned_keys 
+      ? memResize(interned_keys, len * sizeof(char *))
+      : memCalloc(len, sizeof(char *));
+    if (!keys) return -1; // TODO: return error code
+
+    interned_keys = keys;
+    interned_len = len;
+  }
+
+  interned_keys[ninterned++] = atom;
+
+  return TD_OK;
+}
+
+int
+taskKeyIsInterned(const char *key)
+{
+  if (!key) return 0;
+
+  for (int i=0; i < ninterned; i++)
+    if (interned_keys[i] == key) return 1;
+
+  // A key that was never interned as an atom can't have been marked
+  const char *atom = atomFind(key);
+  if (!atom || atom == key) return 0;
+  for (int i=0; i < ninterned; i++)
+    if (interned_keys[i] == atom) return 1;
+
+  return 0;
+}
+
 task_T 
 taskNew() 
 {
   task_T task;
   task = memCalloc(1, sizeof(*task));
+  if (!task) return NULL;
+
+  task->id = task->parent_id = TASK_NOID;
   return task;
 }
 
+// -----------------------------------------------------------------------------
+// Pool
+// -----------------------------------------------------------------------------
+
+#define POOL_CHUNK_LEN 1024 // number of tasks in a chunk
+
+struct taskPool_T {
+  struct task_T **chunks; // array of chunks of tasks
+  int nchunks;            // number of chunks
+  int chunks_len;         // length of chunks array
+  int nused;              // number of tasks handed out from the last chunk
+  task_T free;            // tasks returned to the pool, linked by rlink
+  arena_T arena;          // arena the pool allocates from, or NULL
+};
+
+taskPool_T
+taskPoolNew(arena_T arena)
+{
+  taskPool_T pool;
+  if (arena) pool = arenaCalloc(arena, 1, sizeof(*pool));
+  else pool = memCalloc(1, sizeof(*pool));
+  if (!pool) return NULL;
+
+  pool->arena = arena;
+  return pool;
+}
+
+static int
+taskPoolGrow(taskPool_T pool)
+{
+  if (pool->nchunks >= pool->chunks_len) {
+    int len = pool->chunks_len ? pool->chunks_len << 1 : 8;
+    struct task_T **chunks;
+
+    if (pool->arena) {
+      chunks = arenaAlloc(pool->arena, len * sizeof(*chunks));
+      if (chunks && pool->chunks) {
+        memcpy(chunks, pool->chunks, pool->nchunks * sizeof(*chunks));
+        arenaRelease(pool->arena, pool->chunks,
+          pool->chunks_len * sizeof(*chunks));
+      }
+    } else if (pool->chunks)
+      chunks = memResize(pool->chunks, len * sizeof(*chunks));
+    else
+      chunks = memCalloc(len, sizeof(*chunks));
+    if (!chunks) return -1;
+
+    pool->chunks = chunks;
+    pool->chunks_len = len;
+  }
+
+  struct task_T *chunk = pool->arena
+    ? arenaCalloc(pool->arena, POOL_CHUNK_LEN, sizeof(*chunk))
+    : memCalloc(POOL_CHUNK_LEN, sizeof(*chunk));
+  if (!chunk) return -1;
+
+  pool->chunks[pool->nchunks++] = chunk;
+  pool->nused = 0;
+
+  return TD_OK;
+}
+
+task_T
+taskPoolAlloc(taskPool_T pool)
+{
+  if (!pool) return NULL;
+
+  task_T task;
+  if (pool->free) {
+    task = pool->free;
+    pool->free = task->rlink;
+    memset(task, 0, sizeof(*task));
+  } else {
+    if ((pool->nchunks == 0 || pool->nused == POOL_CHUNK_LEN) &&
+        taskPoolGrow(pool) != TD_OK)
+      return NULL;
+    task = &pool->chunks[pool->nchunks-1][pool->nused++];
+  }
+
+  task->pool = pool;
+  task->arena = pool->arena;
+  task->id = task->parent_id = TASK_NOID;
+  return task;
+}
+
+/**
+ * This frees the chunks holding the tasks but not the fields of the tasks
+ */
+void
+taskPoolFree(taskPool_T *pool)
+{
+  if (!(pool && *pool)) return;
+
+  // Everything was allocated from the arena and is released with it
+  if ((*pool)->arena) {
+    *pool = NULL;
+    return;
+  }
+
+  for (int i=0; i < (*pool)->nchunks; i++)
+    free((*pool)->chunks[i]);
+
+  memFree((*pool)->chunks);
+  free(*pool);
+  *pool = NULL;
+}
+
+// -----------------------------------------------------------------------------
+// Task
+// -----------------------------------------------------------------------------
+
+static int
+parseId(const char *val)
+{
+  char *end;
+  long id = strtol(val, &end, 10);
+  if (end == val || *end != '\0' || id < 0 || id > INT_MAX) return TASK_NOID;
+  else return id;
+}
+
+/**
+ * Keeps the parsed fields of the task in sync with the value of key,
+ * which is an atom
+ */
+static void
+taskParseField(task_T task, const char *key, const char *val)
+{
+  static const char *id, *parent_id, *status;
+  if (!id) {
+    id = atomString("id");
+    parent_id = atomString("parent_id");
+    status = atomString("status");
+  }
+
+  if (key == id) task->id = parseId(val);
+  else if (key == parent_id) task->parent_id = parseId(val);
+  else if (key == status) 
+    task->status = strcasecmp(val, "Complete") == 0 ? TS_COMPLETE : TS_OPEN;
+}
+
 int 
 taskSize(const task_T task) 
 {
   if (!task) return TD_INVALIDARG;
+  return task->nelems;
+}
+
+static elem_T
+taskFindAtom(const task_T task, const char *atom)
+{
+  for (int i=0; i < task->nelems; i++)
+    if (task->elems[i].key == atom)
+      return &task->elems[i];
+
+  return NULL;
+}
+
+/**
+ * Keys are atoms, so callers that pass an atom are matched by pointer
+ * without hashing the key. Otherwise the key is interned and matched.
+ */
+static elem_T
+taskFindElem(const task_T task, const char *key, const char **atom)
+{
+  elem_T elem = taskFindAtom(task, key);
+  if (elem) {
+    if (atom) *atom = elem->key;
+    return elem;
+  }
+
+  const char *interned = atomString(key);
+  if (atom) *atom = interned;
+  if (interned == key) return NULL;
 
-  elem_T elem;
-  int size = 0;
-  for (elem=task->head; elem; elem=elem->link) size++;
+  return taskFindAtom(task, interned);
+}
+
+/**
+ * The fields of a task are allocated from its arena, if it has one,
+ * in which case they're released with the arena rather than freed
+ */
+static void *
+taskAlloc(const task_T task, const long nbytes)
+{
+  if (task->arena) return arenaAlloc(task->arena, nbytes);
+  else return memAlloc(nbytes);
+}
 
-  return size;
+/**
+ * Gives back memory from taskAlloc, where nbytes is the size it was
+ * allocated with, so the arena can hand it out again
+ */
+static void
+taskRelease(const task_T task, void *ptr, const long nbytes)
+{
+  if (task->arena) arenaRelease(task->arena, ptr, nbytes);
+  else memFree(ptr);
+}
+
+static void
+elemRelease(const task_T task, elem_T elem)
+{
+  if (elem->val && !elem->is_atom)
+    taskRelease(task, elem->val, strlen(elem->val) + 1);
+}
+
+static elem_T
+taskAddElem(task_T task)
+{
+  if (task->nelems >= task->elems_len) {
+    int len = task->elems_len ? task->elems_len << 1 : 16;
+    elem_T elems = taskAlloc(task, len * sizeof(*elems));
+    if (!elems) return NULL;
+
+    if (task->elems) {
+      memcpy(elems, task->elems, task->nelems * sizeof(*elems));
+      taskRelease(task, task->elems, task->elems_len * sizeof(*elems));
+    }
+
+    task->elems = elems;
+    task->elems_len = len;
+  }
+
+  elem_T elem = &task->elems[task->nelems++];
+  memset(elem, 0, sizeof(*elem));
+  return elem;
+}
+
+static int
+elemSetVal(task_T task, elem_T elem, const char *val, const int intern)
+{
+  char *ptr = NULL;
+  size_t len = strlen(val);
+
+  if (intern) {
+    if (!(ptr = (char *) atomNew(val, len))) return -1;
+  } else if (len >= ELEM_INLINE_LEN) {
+    if (!(ptr = taskAlloc(task, len + 1))) return -1;
+    memcpy(ptr, val, len + 1);
+  }
+
+  elemRelease(task, elem);
+  elem->val = ptr;
+  elem->is_atom = intern;
+  if (!ptr) memmove(elem->buf, val, len + 1);
+
+  return TD_OK;
 }
 
 // TODO: throw error if alloc fails
@@ -65,29 +354,27 @@ taskSet(task_T task, const char *key, const char *val)
 
   if (!val) val = "";
 
-  elem_T elem;
-
-  for (elem=task->head; elem; elem=elem->link) {
-    if (strcmp(elem->key, key) == 0) {
-      free(elem->val);
-      elem->val = strdup(val);
-      return;
-    }
+  // val may be held inline by this task, where growing the fields
+  // would move it, so we copy it out first
+  char tmp[ELEM_INLINE_LEN];
+  uintptr_t addr = (uintptr_t) val, start = (uintptr_t) task->elems;
+  if (task->elems && addr >= start && 
+      addr < start + task->elems_len * sizeof(*task->elems)) {
+    strcpy(tmp, val);
+    val = tmp;
   }
 
-  elem = memCalloc(1, sizeof(*elem)); 
-  if (!elem) return;
-
-  elem->key = strdup(key);
-  elem->val = strdup(val);
-
-  if (task->tail) 
-    task->tail->link = elem;
-  else
-    task->head = elem; // head is empty, initialize it
+  const char *atom;
+  elem_T elem = taskFindElem(task, key, &atom);
+  if (!elem) {
+    if (!atom) return;
+    if (!(elem = taskAddElem(task))) return;
+    elem->key = atom;
+  }
 
-  task->tail = elem;
-  
+  int intern = ninterned && taskKeyIsInterned(elem->key);
+  if (elemSetVal(task, elem, val, intern) != TD_OK) return;
+  taskParseField(task, elem->key, val);
 }
 
 char *
@@ -95,26 +382,118 @@ taskGet(const task_T task, const char *key)
 {
   if (!(task && key)) return NULL;
 
-  for (elem_T elem=task->head; elem; elem=elem->link)
-    if (strcmp(elem->key, key) == 0)
-      return elem->val;
+  return elemVal(taskFindElem(task, key, NULL));
+}
 
-  return NULL;
+char *
+taskGetSlot(const task_T task, const int slot)
+{
+  if (!task || slot < 0 || slot >= task->nelems) return NULL;
+  return elemVal(&task->elems[slot]);
+}
+
+/**
+ * keys is expected to hold atoms, such as the keys of a list
+ */
+int
+taskConform(task_T task, const char **keys, const int nkeys)
+{
+  if (!(task && keys)) return TD_INVALIDARG;
+
+  // Tasks read from a backend already have their fields in key order
+  int i;
+  for (i=0; i < nkeys && i < task->nelems; i++)
+    if (task->elems[i].key != keys[i]) break;
+
+  if (i == nkeys) return TD_OK;
+
+  int len = task->nelems + nkeys;
+  elem_T elems = taskAlloc(task, len * sizeof(*elems));
+  if (!elems) return -1; // TODO: return error code
+  memset(elems, 0, len * sizeof(*elems));
+
+  int n = 0;
+  for (i=0; i < nkeys; i++) {
+    elem_T elem = taskFindAtom(task, keys[i]);
+    if (elem) {
+      elems[n++] = *elem;
+      elem->key = NULL; // mark as moved
+    } else {
+      // memset leaves the inline value as ""
+      elems[n++].key = keys[i];
+      taskParseField(task, keys[i], "");
+    }
+  }
+
+  for (i=0; i < task->nelems; i++)
+    if (task->elems[i].key) elems[n++] = task->elems[i];
+
+  taskRelease(task, task->elems, task->elems_len * sizeof(*elems));
+  task->elems = elems;
+  task->nelems = n;
+  task->elems_len = len;
+
+  return TD_OK;
+}
+
+int
+taskSetArena(task_T task, arena_T arena)
+{
+  if (!task) return TD_INVALIDARG;
+  if (task->arena == arena) return TD_OK;
+
+  struct task_T dst = { .arena = arena };
+  int len = task->nelems;
+  elem_T elems = NULL;
+
+  if (len) {
+    if (!(elems = taskAlloc(&dst, len * sizeof(*elems)))) return -1;
+    memcpy(elems, task->elems, len * sizeof(*elems));
+  }
+
+  for (int i=0; i < len; i++) {
+    char *val = task->elems[i].val;
+    if (!val || task->elems[i].is_atom) continue;
+
+    size_t n = strlen(val) + 1;
+    if (!(elems[i].val = taskAlloc(&dst, n))) {
+      for (int j=0; j < i; j++) elemRelease(&dst, &elems[j]);
+      taskRelease(&dst, elems, len * sizeof(*elems));
+      return -1; // TODO: return error code
+    }
+    memcpy(elems[i].val, val, n);
+  }
+
+  for (int i=0; i < len; i++) elemRelease(task, &task->elems[i]);
+
+  taskRelease(task, task->elems, task->elems_len * sizeof(*task->elems));
+  task->elems = elems;
+  task->elems_len = len;
+  task->arena = arena;
+
+  return TD_OK;
 }
 
 elem_T
 taskElemInd(const task_T task, const int ind)
 {
-  if (taskSize(task) == 0 || ind >= taskSize(task))
+  if (!task || ind < 0 || ind >= task->nelems)
     return NULL;
 
-  elem_T elem = task->head;
-  for (int i=0; i<ind; i++, elem=elem->link);
+  return &task->elems[ind];
+}
 
-  return elem;
+elem_T
+taskNextElem(const task_T task, const elem_T elem)
+{
+  if (!(task && task->nelems)) return NULL;
+
+  elem_T next = elem ? elem + 1 : task->elems;
+  if (next >= task->elems + task->nelems) return NULL;
+  else return next;
 }
 
-char *
+const char *
 elemKey(const elem_T elem)
 {
   if (!elem) return NULL;
@@ -125,7 +504,7 @@ char *
 elemVal(const elem_T elem)
 {
   if (!elem) return NULL;
-  else return elem->val;
+  else return elem->val ? elem->val : elem->buf;
 }
 
 char *
@@ -134,7 +513,7 @@ taskValInd(const task_T task, const int ind)
   return elemVal(taskElemInd(task, ind));
 }
 
-char *
+const char *
 taskKeyInd(const task_T task, const int ind)
 {
   return elemKey(taskElemInd(task, ind));
@@ -155,15 +534,19 @@ taskFree(task_T *task)
 {
   if (!(task && *task)) return;
 
-  elem_T elem, link;
+  for (int i=0; i < (*task)->nelems; i++)
+    elemRelease(*task, &(*task)->elems[i]);
+
+  taskRelease(*task, (*task)->elems,
+    (*task)->elems_len * sizeof(*(*task)->elems));
+
+  taskPool_T pool = (*task)->pool;
+  if (pool) {
+    memset(*task, 0, sizeof(**task));
+    (*task)->rlink = pool->free;
+    pool->free = *task;
+  } else free(*task);
 
-  for (elem=(*task)->head; elem; elem=link) {
-    link = elem->link;
-    memFree(elem->key);
-    memFree(elem->val);
-    memFree(elem);
-  }
-  free(*task);
   *task = NULL;
 }
 
@@ -180,6 +563,17 @@ taskGetNext(const task_T task)
   if (!task) return NULL;
   else return task->rlink;
 }
+
+bool
+taskIsDescendant(task_T task, const task_T ancestor)
+{
+  if (!ancestor) return false;
+
+  for ( ; task; task=task->parent)
+    if (task == ancestor) return true;
+
+  return false;
+}
   
 int
 taskSwap(task_T old, task_T new)
@@ -188,11 +582,20 @@ taskSwap(task_T old, task_T new)
 
   struct task_T tmp = *old;
 
+  // Each task stays with the pool it was allocated from
+  tmp.pool = new->pool;
+  new->pool = old->pool;
+
   new->llink = old->llink;
   new->rlink = old->rlink;
   new->child = old->child;
   new->parent = old->parent;
+  new->dirty = old->dirty;
   new->level = old->level;
+  new->nsubtasks = old->nsubtasks;
+  new->nopen = old->nopen;
+  new->row = old->row;
+  new->linked = old->linked;
   new->flags |= old->flags; // TODO: double check that we want to do this
   *old = *new;
 
@@ -233,6 +636,27 @@ taskGetFlag(task_T task, const int flags)
  else return 0;
 }
 
+int
+taskGetId(const task_T task)
+{
+  if (!task) return TASK_NOID;
+  return task->id;
+}
+
+int
+taskGetParentId(const task_T task)
+{
+  if (!task) return TASK_NOID;
+  return task->parent_id;
+}
+
+int
+taskGetStatus(const task_T task)
+{
+  if (!task) return TD_INVALIDARG;
+  return task->status;
+}
+
 int
 taskSetLevel(task_T task, const int level)
 {
@@ -246,5 +670,25 @@ int
 taskGetLevel(const task_T task)
 {
   if (!task) return TD_INVALIDARG;
-  return task->level;
+
+  // Counted from the parents rather than kept up to date, so that moving
+  // a subtree doesn't have to visit it
+  int level = 0;
+  for (task_T node=task->parent; node; node=node->parent) level++;
+
+  return level;
+}
+
+int
+taskNumSubtasks(const task_T task)
+{
+  if (!task) return 0;
+  return task->nsubtasks;
+}
+
+int
+taskNumOpenSubtasks(const task_T task)
+{
+  if (!task) return 0;
+  return task->nopen;
 }
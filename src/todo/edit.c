@@ -43,8 +43,8 @@ writeTaskToTmpFile(char *template, const task_T task)
   if (fd == -1) 
     errExit("Failed editing task: temp file not successfully created");
 
-  for (int i=0; i < taskSize(task); i++) {
-    elem_T elem = taskElemInd(task, i);
+  elem_T elem = NULL;
+  while ((elem = taskNextElem(task, elem))) {
     if (strcmp(elemKey(elem), "id") == 0) continue;
     int size = dprintf(fd, "%s: %s\n", elemKey(elem), elemVal(elem));
     if (size < 0)
@@ -237,21 +237,21 @@ parseEditedFile(const char *filename, task_T task)
 static void
 enforceParentCategory(const list_T list, task_T edit)
 {
-  task_T task = listFindTaskById(list, taskGet(edit, "id"));
+  task_T task = listFindTaskById(list, taskGetId(edit));
 
-  char *task_parent = taskGet(task, "parent_id");
-  char *edit_parent = taskGet(edit, "parent_id");
+  int task_parent = taskGetParentId(task);
+  int edit_parent = taskGetParentId(edit);
 
   task_T parent = listFindTaskById(list, edit_parent);
 
   // Case 1: No parent id or parent id is removed
   // Allow any change to category
-  if (strcmp(edit_parent, "") == 0) ;
+  if (strcmp(taskGet(edit, "parent_id"), "") == 0) ;
 
   // Case 2: Parent id is unchanged
   // Enforce that the category must go unchanged
-  else if (strcmp(task_parent, edit_parent) == 0)
-    taskSet(edit, "category", taskGet(parent, "category"));
+  else if (edit_parent != TASK_NOID && task_parent == edit_parent)
+    taskSet(edit, "category", listTaskGet(list, parent, LS_CATEGORY));
 
   // Case 3: Parent id is added or changed
   // Error if new id of parent doesn't exist
@@ -259,13 +259,12 @@ enforceParentCategory(const list_T list, task_T edit)
     if (!parent)
       errExit("Edited task invalid: task belonging to new parent doesn't exit");
 
-    // Error if the new parent is one of the children
-    task_T child = taskFindChildById(task, edit_parent);
-    if (child) 
+    // Error if the new parent is the task or one of its subtasks
+    if (taskIsDescendant(parent, task))
       errExit("Edited task invalid: a subtask can't become that task's parent");
 
     // Otherwise enforce that the category is that of the new parent
-    taskSet(edit, "category", taskGet(parent, "category"));
+    taskSet(edit, "category", listTaskGet(list, parent, LS_CATEGORY));
 
   }
 }
@@ -278,8 +277,8 @@ validateEditedTask(const list_T list, task_T edit)
 
   enforceParentCategory(list, edit);
 
-  for (int i=0; i < taskSize(edit); i++) {
-    elem_T elem = taskElemInd(edit, i);
+  elem_T elem = NULL;
+  while ((elem = taskNextElem(edit, elem))) {
     if (!listContainsKey(list, elemKey(elem)))
       errExit("Edited task invalid: unrecognized or corrupted fields");
   }
@@ -292,8 +291,8 @@ editTask(list_T list, task_T task)
     errExit("Failed to edit task: null pointer passed as argument");
   
   task_T edit = taskNew();
-  taskSet(edit, "id", taskGet(task, "id"));
-  taskSet(edit, "category", taskGet(task, "category"));
+  taskSet(edit, "id", listTaskGet(list, task, LS_ID));
+  taskSet(edit, "category", listTaskGet(list, task, LS_CATEGORY));
 
   taskSetFlag(edit, TF_UPDATE);
 
@@ -330,8 +329,8 @@ addTask(list_T list, line_T line)
   if (!(list && line))
     errExit("Failed to add task: null pointer passed as argument");
 
-  task_T task = taskNew();
-  char **keys = listGetKeys(list);
+  task_T task = listNewTask(list);
+  const char **keys = listGetKeys(list);
 
   for (int i=0; i < listNumKeys(list); i++)
     taskSet(task, keys[i], NULL);
@@ -352,8 +351,9 @@ addTask(list_T list, line_T line)
     break;
   
   case LT_TASK:
-    taskSet(task, "parent_id", taskGet((task_T) lineObj(line), "id"));
-    taskSet(task, "category", taskGet((task_T) lineObj(line), "category"));
+    taskSet(task, "parent_id", listTaskGet(list, (task_T) lineObj(line), LS_ID));
+    taskSet(task, "category", 
+      listTaskGet(list, (task_T) lineObj(line), LS_CATEGORY));
     break;
 
   default:
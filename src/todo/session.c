@@ -0,0 +1,260 @@
+//
+// -----------------------------------------------------------------------------
+// session.c
+// -----------------------------------------------------------------------------
+//
+// Copyright (c) 2022 Tyler Wayne
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <stdlib.h>          // free
+#include <string.h>          // strcmp, strdup
+#include "return-codes.h"    // TD_OK, TD_INVALIDARG
+#include "mem.h"             // memCalloc, memResize, memFree
+#include "list.h"            // listNew, listSize, listSetHistory, listAddView
+#include "filter.h"          // filterNew, filterHasKey, filterFree
+#include "backend-sqlite3.h" // readTasks, writeUpdates
+#include "session.h"
+
+session_T
+sessionNew(const char *filename, const long budget, const int history)
+{
+  if (!filename) return NULL;
+
+  session_T session = memCalloc(1, sizeof(*session));
+  if (!session) return NULL;
+
+  session->filename = strdup(filename);
+  if (!session->filename) {
+    memFree(session);
+    return NULL;
+  }
+
+  session->budget = budget;
+  session->history = history;
+
+  return session;
+}
+
+static void
+sessionUnlink(session_T session, struct sessionList *entry)
+{
+  if (entry->prev) entry->prev->next = entry->next;
+  else session->head = entry->next;
+
+  if (entry->next) entry->next->prev = entry->prev;
+  else session->tail = entry->prev;
+
+  entry->prev = entry->next = NULL;
+  session->nlists--;
+}
+
+static void
+sessionPush(session_T session, struct sessionList *entry)
+{
+  entry->prev = NULL;
+  entry->next = session->head;
+
+  if (session->head) session->head->prev = entry;
+  else session->tail = entry;
+
+  session->head = entry;
+  session->nlists++;
+}
+
+/**
+ * Frees lists from the least recently used until the rest fit in the
+ * budget. There are few enough lists that they're summed each time
+ * rather than tracked as they grow.
+ */
+static void
+sessionEvict(session_T session)
+{
+  long size = 0;
+  for (struct sessionList *entry=session->head; entry; entry=entry->next)
+    size += listSize(entry->list);
+
+  struct sessionList *entry, *prev;
+  for (entry=session->tail; entry && size > session->budget; entry=prev) {
+    prev = entry->prev;
+    if (entry == session->head || listNumUpdates(entry->list) > 0) continue;
+
+    size -= listSize(entry->list);
+    sessionUnlink(session, entry);
+    listFree(&entry->list);
+    memFree(entry);
+  }
+}
+
+static struct sessionList *
+sessionFind(const session_T session, const char *name)
+{
+  for (struct sessionList *entry=session->head; entry; entry=entry->next)
+    if (strcmp(listName(entry->list), name) == 0) return entry;
+
+  return NULL;
+}
+
+int
+sessionAddView(session_T session, const char *name, const char *query)
+{
+  if (!(session && name)) return TD_INVALIDARG;
+
+  // Checked once here, so that adding it to a list only fails for memory
+  filter_T filter = filterNew(query);
+  int valid = filter && !filterHasKey(filter, "position");
+  filterFree(&filter);
+  if (!valid) return TD_INVALIDARG;
+
+  struct sessionView *views = session->views ?
+    memResize(session->views, (session->nviews + 1) * sizeof(*views)) :
+    memCalloc(1, sizeof(*views));
+  if (!views) return -1; // TODO: return error code
+  session->views = views;
+
+  struct sessionView *added = &views[session->nviews];
+  added->name = strdup(name);
+  added->query = strdup(query);
+  if (!(added->name && added->query)) {
+    free(added->name);
+    free(added->query);
+    return -1; // TODO: return error code
+  }
+  session->nviews++;
+
+  for (struct sessionList *entry=session->head; entry; entry=entry->next)
+    if (!listAddView(entry->list, name, query))
+      return -1; // TODO: return error code
+
+  return TD_OK;
+}
+
+int
+sessionAdd(session_T session, list_T list)
+{
+  if (!(session && list)) return TD_INVALIDARG;
+
+  if (listSetHistory(list, session->history) != TD_OK)
+    return -1; // TODO: return error code
+
+  for (int i=0; i < session->nviews; i++)
+    if (!listAddView(list, session->views[i].name, session->views[i].query))
+      return -1; // TODO: return error code
+
+  struct sessionList *entry = memCalloc(1, sizeof(*entry));
+  if (!entry) return -1; // TODO: return error code
+
+  entry->list = list;
+  sessionPush(session, entry);
+  sessionEvict(session);
+
+  return TD_OK;
+}
+
+int
+sessionSwitch(session_T session, const char *name)
+{
+  if (!(session && name)) return TD_INVALIDARG;
+
+  struct sessionList *entry = sessionFind(session, name);
+  if (entry) {
+    sessionUnlink(session, entry);
+    sessionPush(session, entry);
+
+    // The list that was in view may be the one to go now
+    sessionEvict(session);
+    return TD_OK;
+  }
+
+  list_T list = listNew(name);
+  if (!list) return -1; // TODO: return error code
+
+  int rc = readTasks(list, session->filename);
+  if (rc != TD_OK) {
+    listFree(&list);
+    return rc;
+  }
+
+  rc = sessionAdd(session, list);
+  if (rc != TD_OK) listFree(&list);
+
+  return rc;
+}
+
+struct sessionList *
+sessionCurrent(const session_T session)
+{
+  if (!session) return NULL;
+  else return session->head;
+}
+
+list_T
+sessionGetList(const session_T session, const char *name)
+{
+  if (!(session && name)) return NULL;
+
+  struct sessionList *entry = sessionFind(session, name);
+  return entry ? entry->list : NULL;
+}
+
+int
+sessionNumUpdates(const session_T session)
+{
+  if (!session) return 0;
+
+  int n = 0;
+  for (struct sessionList *entry=session->head; entry; entry=entry->next)
+    n += listNumUpdates(entry->list);
+
+  return n;
+}
+
+int
+sessionWriteUpdates(session_T session)
+{
+  if (!session) return TD_INVALIDARG;
+
+  int rc = TD_OK;
+  for (struct sessionList *entry=session->head; entry; entry=entry->next) {
+    if (listNumUpdates(entry->list) == 0) continue;
+
+    int list_rc = writeUpdates(entry->list, session->filename);
+    if (rc == TD_OK) rc = list_rc;
+  }
+
+  return rc;
+}
+
+void
+sessionFree(session_T *session)
+{
+  if (!(session && *session)) return;
+
+  struct sessionList *entry, *next;
+  for (entry=(*session)->head; entry; entry=next) {
+    next = entry->next;
+    listFree(&entry->list);
+    memFree(entry);
+  }
+
+  for (int i=0; i < (*session)->nviews; i++) {
+    free((*session)->views[i].name);
+    free((*session)->views[i].query);
+  }
+
+  memFree((*session)->views);
+  free((*session)->filename);
+  memFree(*session);
+  *session = NULL;
+}
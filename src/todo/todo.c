@@ -18,9 +18,11 @@
 // limitations under the License.
 //
 
-#include <stdio.h>           // printf, fprintf
-#include <stdlib.h>          // exit, EXIT_SUCCESS, EXIT_FAILURE
-#include <string.h>          // strcmp
+#include <stdio.h>           // printf, fprintf, snprintf
+#include <stdlib.h>          // exit, EXIT_SUCCESS, EXIT_FAILURE, strtol
+#include <string.h>          // strcmp, strdup, strtok_r
+#include <errno.h>           // errno, ERANGE
+#include <limits.h>          // INT_MAX, LONG_MAX
 #include <getopt.h>          // getopt_long
 #include <wordexp.h>         // wordexp_t, wordexp, wordfree
 #include "error-functions.h" // usageErr
@@ -29,6 +31,7 @@
 #include "config-reader.h"   // readConfig
 #include "task.h"            // task_T
 #include "view.h"            // view
+#include "session.h"         // sessionNew, sessionSwitch, sessionAddView
 #include "import.h"          // import
 #include "export.h"          // exportTasks
 #include "backend-sqlite3.h" // createBackend
@@ -86,6 +89,70 @@ expandPath(char *filename)
 }
   
 
+/**
+ * Interns the values of each key in a comma-separated list of keys
+ */
+static void
+internKeys(const char *keys)
+{
+  if (!keys) return;
+
+  char *buf = strdup(keys), *save = NULL;
+  if (!buf) errExit("Unable to allocate interned keys");
+
+  for (char *key=strtok_r(buf, ", ", &save); key; key=strtok_r(NULL, ", ", &save))
+    if (taskInternKey(key) != TD_OK)
+      errExit("Unable to intern values of key %s", key);
+
+  free(buf);
+}
+
+/**
+ * Adds the saved views in a comma-separated list of names to the session.
+ * Each is defined by the query in the config view_<name>
+ */
+static void
+addViews(session_T session, const dict_T configs)
+{
+  char *buf = strdup(dictGet(configs, "views")), *save = NULL;
+  if (!buf) errExit("Unable to allocate saved views");
+
+  char key[64]; // holds "view_" and the name
+  for (char *name=strtok_r(buf, ", ", &save); name; name=strtok_r(NULL, ", ", &save)) {
+    int len = snprintf(key, sizeof(key), "view_%s", name);
+    if (len < 0 || len >= (int) sizeof(key))
+      errExit("Saved view name %s is too long", name);
+
+    const char *query = dictGet(configs, key);
+    if (!query) errExit("Saved view %s isn't defined by %s", name, key);
+
+    if (sessionAddView(session, name, query) != TD_OK)
+      errExit("Unable to add saved view %s", name);
+  }
+
+  free(buf);
+}
+
+/**
+ * Returns the value of a config that has to be a whole number from 0 to
+ * max, exiting with a message naming the config if it isn't
+ */
+static long
+configNumber(const dict_T configs, const char *key, const long max)
+{
+  const char *val = dictGet(configs, key);
+  char *end;
+
+  errno = 0;
+  long n = strtol(val, &end, 10);
+  if (end == val || *end != '\0' || errno == ERANGE)
+    errExit("Config %s must be a number, not '%s'", key, val);
+  if (n < 0 || n > max)
+    errExit("Config %s must be from 0 to %ld, not %ld", key, max, n);
+
+  return n;
+}
+
 int 
 main(int argc, char **argv)
 {
@@ -98,6 +165,10 @@ main(int argc, char **argv)
   dictSet(configs, "filename", "todo.sqlite3");
   dictSet(configs, "listname", "default_list");
   dictSet(configs, "sep", ",");
+  dictSet(configs, "intern_keys", "category,status,priority,effort,timing");
+  dictSet(configs, "cache_size", "64"); // megabytes of lists kept loaded
+  dictSet(configs, "undo_depth", "100"); // changes kept to undo per list
+  dictSet(configs, "views", ""); // saved views, each defined by view_<name>
 
   // Configuration File
   char *config_fn = expandPath("~/.config/todo/todorc");
@@ -162,6 +233,8 @@ main(int argc, char **argv)
     }
   }
 
+  internKeys(dictGet(configs, "intern_keys"));
+
   char *listname = dictGet(configs, "listname");
   char *filename = expandPath(dictGet(configs, "filename"));
 
@@ -169,10 +242,18 @@ main(int argc, char **argv)
 
 #define is_arg(x) (strcmp(argv[optind], (x)) == 0)
 
-  list_T list = listNew(listname);
+  // cache_size is in megabytes, bounded so that it fits in bytes
+  long cache_size = configNumber(configs, "cache_size", LONG_MAX / (1L << 20))
+    * (1L << 20);
+  int undo_depth = configNumber(configs, "undo_depth", INT_MAX);
 
   if (optind == argc || is_arg("view")) {
-    int rc = readTasks(list, filename);
+    session_T session = sessionNew(filename, cache_size, undo_depth);
+    if (!session)
+      errExit("Unable to allocate session");
+    addViews(session, configs);
+
+    int rc = sessionSwitch(session, listname);
       switch (rc) {
       case TD_OK:
         break;
@@ -188,7 +269,8 @@ main(int argc, char **argv)
       default:
         errExit("Unable to read tasks");
       }
-    view(list, filename);
+    view(session);
+    sessionFree(&session);
   }
 
   // TODO: add merge existing
@@ -201,8 +283,17 @@ main(int argc, char **argv)
     if (optind == argc)
       usageErr("Usage: %s [OPTIONS...] import filename\n", argv[0]);
     char *import_filename = argv[optind];
+    list_T list = listNew(listname);
     importTasks(list, &filename, import_filename, *dictGet(configs, "sep"));
-    view(list, filename);
+
+    session_T session = sessionNew(filename, cache_size, undo_depth);
+    if (!session)
+      errExit("Unable to allocate session");
+    addViews(session, configs);
+    if (sessionAdd(session, list) != TD_OK)
+      errExit("Unable to allocate session");
+    view(session);
+    sessionFree(&session);
   }
 
   else if (is_arg("help")) {
@@ -19,20 +19,77 @@
 //
 
 #include <stdio.h>           // printf, dprintf
-#include <stdlib.h>          // calloc, getenv, srand, rand
+#include <stdlib.h>          // calloc, realloc, getenv, srand, rand
 #include <unistd.h>          // unlink, close
 #include <curses.h>          // initscr, cbreak, noecho, getch, endwin
 #include <string.h>          // strdup
 #include <time.h>            // time
 #include <stdbool.h>         // true, false
 #include "error-functions.h" // errMsg
+#include "mem.h"             // memCalloc, memFree
 #include "task.h"            // task_T
 #include "edit.h"            // editTask
-#include "backend-sqlite3.h" // readTasks
+#include "backend-sqlite3.h" // readTasks, readListNames
 #include "backend-delim.h"   // readTasks_delim
 #include "return-codes.h"    // TD_OK
 #include "view.h"
 #include "screen.h"
+#include "session.h"         // sessionSwitch, sessionGetList
+
+// Tasks selected with space, by id, so that 'd' and 'x' act on all of them
+struct selection {
+  int *ids;
+  int  nids;
+  int  len;
+};
+
+static int
+selectionFind(const struct selection *sel, const int id)
+{
+  for (int i=0; i < sel->nids; i++)
+    if (sel->ids[i] == id) return i;
+
+  return -1;
+}
+
+static void
+selectionToggle(struct selection *sel, const int id)
+{
+  int i = selectionFind(sel, id);
+  if (i >= 0) {
+    sel->ids[i] = sel->ids[--sel->nids];
+    return;
+  }
+
+  if (sel->nids >= sel->len) {
+    sel->len = sel->len ? sel->len << 1 : 16;
+    int *ptr = realloc(sel->ids, sel->len * sizeof(int));
+    if (!ptr) errExit("Failed to select task: unable to allocate memory");
+    sel->ids = ptr;
+  }
+
+  sel->ids[sel->nids++] = id;
+}
+
+/**
+ * Applies op to the selected tasks that are still in the list, and
+ * clears the selection
+ */
+static int
+selectionApply(struct selection *sel, list_T list, const int op)
+{
+  task_T *tasks = calloc(sel->nids, sizeof(task_T));
+  if (!tasks) return -1; // TODO: return error code
+
+  for (int i=0; i < sel->nids; i++)
+    tasks[i] = listFindTaskById(list, sel->ids[i]);
+
+  int rc = listApply(list, tasks, sel->nids, op, NULL, NULL);
+  free(tasks);
+  sel->nids = 0;
+
+  return rc;
+}
 
 // TODO: fix line wrapping
 static void
@@ -55,8 +112,9 @@ viewTaskScreen(list_T list, task_T task)
     addstr((val));              \
   } while (0)
 
-    for (int i=0; i < taskSize(task); i++)
-      ADDVAL(taskKeyInd(task, i), BLANKIFNULL(taskValInd(task, i)));
+    elem_T elem = NULL;
+    while ((elem = taskNextElem(task, elem)))
+      ADDVAL(elemKey(elem), BLANKIFNULL(elemVal(elem)));
 
     refresh();
     c = getch();
@@ -68,9 +126,9 @@ viewTaskScreen(list_T list, task_T task)
   } while (1);
 }
 
-// TODO: add filtering logic/command
 static void
-viewListScreen(const screen_T screen, const list_T list)
+viewListScreen(const screen_T screen, const list_T list, 
+  const struct selection *sel)
 {
   clear();
 
@@ -79,10 +137,14 @@ viewListScreen(const screen_T screen, const list_T list)
 
   int level;
   int type;
+  int total;
+  char badge[32]; // holds " [%d/%d]"
   cat_T cat;
   task_T task;
 
   int offset = screen->offset;
+  int name_slot = listKeySlot(list, "name");
+  int timing_slot = listKeySlot(list, "timing");
 
   if (screen->nlines-1 > max_row) 
     max_row = screen->nlines-1;
@@ -104,10 +166,18 @@ viewListScreen(const screen_T screen, const list_T list)
 
       switch (type) {
       case LT_CAT:
+        for (int j=level; j>0; j--) addstr("  ");
         addstr("[");
         cat = (cat_T) lineObj(line);
-        addstr(catName(cat));
+        // A saved view isn't nested, so categories go by their full name
+        addstr(screen->view ? catName(cat) : catLabel(cat));
         addstr("]");
+
+        // Open tasks hidden by folding, from counts the list keeps
+        if (!screen->view && catIsFolded(cat)) {
+          snprintf(badge, sizeof(badge), " (%d)", catNumBranchOpen(cat));
+          addstr(badge);
+        }
         break;
 
       case LT_TASK:
@@ -116,8 +186,19 @@ viewListScreen(const screen_T screen, const list_T list)
           else addstr("  ");
         }
         task = (task_T) lineObj(line);
-        addstr(taskGet(task, "name"));
-        mvaddstr(row, max_col - 3, taskGet(task, "timing"));
+        if (selectionFind(sel, taskGetId(task)) >= 0) attron(A_BOLD);
+        addstr(BLANKIFNULL(taskGetSlot(task, name_slot)));
+        attroff(A_BOLD);
+
+        // Progress of the subtasks, from counts the list keeps. Completed
+        // tasks aren't loaded, so done is those completed since the last
+        // load or save
+        if ((total = taskNumSubtasks(task)) > 0) {
+          snprintf(badge, sizeof(badge), " [%d/%d]", 
+            total - taskNumOpenSubtasks(task), total);
+          addstr(badge);
+        }
+        mvaddstr(row, max_col - 3, BLANKIFNULL(taskGetSlot(task, timing_slot)));
         break;
 
       default: // ignore unrecognized types
@@ -179,6 +260,88 @@ viewHelpScreen()
   unlink(filename);
 }
 
+/**
+ * Shows nrows rows, drawn by rowText, and lets the user move between them
+ * with j and k, starting on row cur. Returns the row picked with enter,
+ * or -1 if q is pressed. Rows are clipped to the width of the screen.
+ */
+static int
+viewPicker(const int nrows, int cur,
+  void (*rowText)(const void *data, const int row, char *buf, size_t len),
+  const void *data)
+{
+  int max_row, max_col, offset = 0;
+  getmaxyx(stdscr, max_row, max_col);
+  if (cur >= max_row) offset = cur - max_row + 1;
+
+  char c;
+  char text[256]; // holds a row, before it's clipped
+  do {
+    clear();
+
+    for (int row=0; row < max_row && offset + row < nrows; row++) {
+      rowText(data, offset + row, text, sizeof(text));
+      mvaddnstr(row, 0, text, max_col);
+      if (offset + row == cur) mvchgat(row, 0, -1, A_UNDERLINE, 0, NULL);
+    }
+
+    refresh();
+    c = getch();
+
+    if (c == 'j' && cur < nrows - 1) {
+      if (++cur - offset >= max_row) offset++;
+    } else if (c == 'k' && cur > 0) {
+      if (--cur < offset) offset--;
+    } else if (c == '\n' && nrows > 0) return cur;
+
+  } while (c != 'q');
+
+  return -1;
+}
+
+struct listRows {
+  session_T    session;
+  const char **names;
+};
+
+// Loaded lists are marked with '*', or '+' if they have unsaved updates
+static void
+listRowText(const void *data, const int row, char *buf, size_t len)
+{
+  const struct listRows *rows = data;
+  list_T list = sessionGetList(rows->session, rows->names[row]);
+  snprintf(buf, len, "%s%s", 
+    !list ? "  " : listNumUpdates(list) ? "+ " : "* ", rows->names[row]);
+}
+
+/**
+ * Shows the lists in the session's file and returns the name of the one
+ * picked, or NULL if none is. Loaded lists are marked with '*', or '+'
+ * if they have unsaved updates.
+ */
+static const char *
+viewListSwitcher(const session_T session)
+{
+  struct listRows rows = { .session = session };
+  int nnames;
+  if (readListNames(session->filename, &rows.names, &nnames) != TD_OK)
+    return NULL;
+
+  int cur = 0;
+  const char *name = sessionCurrent(session) ? 
+    listName(sessionCurrent(session)->list) : NULL;
+  for (int i=0; name && i < nnames; i++)
+    if (strcmp(rows.names[i], name) == 0) cur = i;
+
+  cur = viewPicker(nnames, cur, listRowText, &rows);
+  name = cur < 0 ? NULL : rows.names[cur];
+
+  // The names are atoms, so they outlast the array
+  memFree(rows.names);
+
+  return name;
+}
+
 static int
 moveDown(const screen_T screen, line_T *line)
 {
@@ -240,10 +403,63 @@ moveUp(const screen_T screen, line_T *line)
 } while (0)
 
 
+struct viewRows {
+  list_T       list;
+  view_T       shown;
+  view_T      *views; // views[0] is NULL, for the whole list
+};
+
+// The view shown is marked with '*', and each view has its count
+static void
+viewRowText(const void *data, const int row, char *buf, size_t len)
+{
+  const struct viewRows *rows = data;
+  view_T view = rows->views[row];
+  const char *mark = view == rows->shown ? "* " : "  ";
+
+  if (view) snprintf(buf, len, "%s%s (%d)", mark, viewName(view),
+    listViewNumTasks(rows->list, view));
+  else snprintf(buf, len, "%sAll tasks", mark);
+}
+
+/**
+ * Lets the user pick one of the list's saved views, or the whole list,
+ * with j, k and enter. Returns whether one was picked, setting *picked
+ * to it or to NULL for the whole list
+ */
+static int
+viewSavedSwitcher(const list_T list, const view_T shown, view_T *picked)
+{
+  int nviews = 0, cur = 0;
+  view_T view = NULL;
+  while ((view = listNextView(list, view))) nviews++;
+
+  // Row 0 is the whole list, and each view after it
+  struct viewRows rows = { .list = list, .shown = shown };
+  rows.views = memCalloc(nviews + 1, sizeof(view_T));
+  if (!rows.views) return 0;
+
+  view = NULL;
+  for (int i=1; i <= nviews; i++) {
+    rows.views[i] = view = listNextView(list, view);
+    if (view == shown) cur = i;
+  }
+
+  cur = viewPicker(nviews + 1, cur, viewRowText, &rows);
+  if (cur >= 0) *picked = rows.views[cur];
+  memFree(rows.views);
+
+  return cur >= 0;
+}
+
 static void 
-eventLoop(list_T list, const char *filename)
+eventLoop(session_T session)
 {
-  if (!list) return;
+  struct sessionList *cur = sessionCurrent(session);
+  if (!cur) return;
+
+  list_T list = cur->list;
+  const char *filename = session->filename;
 
   // TODO: this is needed here so that we can clear
   // the status line before the loop. Move to a better place
@@ -252,9 +468,11 @@ eventLoop(list_T list, const char *filename)
 
   screen_T screen = screenNew();
   task_T task;
+  struct selection sel = { 0 };
+  char msg[64]; // holds a status message with a 15 digit int
 
   screenInitialize(screen, list);
-  viewListScreen(screen, list);
+  viewListScreen(screen, list, &sel);
   
   // TODO: should we add status row logic to the view functions?
   clearStatusLine();
@@ -267,6 +485,12 @@ eventLoop(list_T list, const char *filename)
   char c;
   int rc;
   int status_row;
+  int template_id = TASK_NOID; // task copied with 'y'
+  int marked_id = TASK_NOID;   // task cut with 'm'
+  const char *name;            // list picked with 'L'
+  view_T shown;                // saved view picked with 'V'
+  const char *notice = NULL;   // status message to show after a redraw
+  task_T follow = NULL;        // task for the cursor to stay on
   bool redraw = false;
   while ((c = getch())) {
 
@@ -277,10 +501,28 @@ eventLoop(list_T list, const char *filename)
     switch (c) {
 
     // TODO: whenever we get input, we could receive a KEY_RESIZE. handle it
-    // TODO: add command to fold categories
-    // TODO: create an undo option (this will require substantial work)
     // TODO: add a command for long options ':'
 
+    case ' ': // Select task
+      if (lineType(line) == LT_TASK) {
+        selectionToggle(&sel, taskGetId((task_T) lineObj(line)));
+        redraw = true;
+      }
+      break;
+
+    case '<': // Move task out from under its parent
+    case '>': // Move task under the sibling before it
+      if (lineType(line) == LT_TASK) {
+        task = (task_T) lineObj(line);
+        rc = c == '>' ? listIndentTask(list, task) : listOutdentTask(list, task);
+        if (rc == TD_OK) {
+          follow = task;
+          redraw = true;
+        } else statusMessage("Task can't move any further.");
+        move(cur_row, cur_col);
+      }
+      break;
+
     case 'a': // Add task
       if (lineType(line) == LT_CAT || lineType(line) == LT_TASK) {
         addTask(list, line);
@@ -289,7 +531,15 @@ eventLoop(list_T list, const char *filename)
       break;
 
     case 'd': // Delete task
-      if (lineType(line) == LT_TASK) {
+      if (sel.nids > 0) {
+        snprintf(msg, sizeof(msg), 
+          "Delete %d selected tasks and their subtasks? (y/n) ", sel.nids);
+        statusMessage(msg);
+        if (getch() != 'y') statusMessage("Tasks left unchanged.");
+        else if (selectionApply(&sel, list, LO_DELETE) == TD_OK) redraw = true;
+        else statusMessage("Unable to delete tasks.");
+        move(cur_row, cur_col);
+      } else if (lineType(line) == LT_TASK) {
         task = (task_T) lineObj(line);
         statusMessage("Delete task (y/n) ");
         if (getch() != 'y') statusMessage("Task left unchanged.");
@@ -316,6 +566,20 @@ eventLoop(list_T list, const char *filename)
       }
       break;
 
+    case 'J': // Move task down among its siblings
+    case 'K': // Move task up among its siblings
+      if (lineType(line) == LT_TASK) {
+        task = (task_T) lineObj(line);
+        if (!listContainsKey(list, "position"))
+          statusMessage("List has no position field to order tasks by.");
+        else if (listMoveTask(list, task, c == 'K' ? -1 : 1) == TD_OK) {
+          follow = task;
+          redraw = true;
+        } else statusMessage("Task can't move any further.");
+        move(cur_row, cur_col);
+      }
+      break;
+
     case 'h': // View help screen
       viewHelpScreen();
       break;
@@ -328,8 +592,89 @@ eventLoop(list_T list, const char *filename)
       redraw = moveUp(screen, &line);
       break;
 
+    case 'L': // Switch list
+      name = viewListSwitcher(session);
+      if (name && strcmp(name, listName(list))) {
+        cur->offset = screen->offset;
+        cur->cur_row = cur_row;
+
+        rc = sessionSwitch(session, name);
+        if (rc == TD_OK) {
+          cur = sessionCurrent(session);
+          list = cur->list;
+          screen->offset = cur->offset;
+          cur_row = cur->cur_row;
+
+          // These are ids, and the saved view, of the list that was in view
+          screen->view = NULL;
+          sel.nids = 0;
+          template_id = marked_id = TASK_NOID;
+        } else notice = "Unable to read list.";
+      }
+
+      // The switcher drew over the list, so it's redrawn either way
+      redraw = true;
+      break;
+
+    case 'm': // Mark task to move
+      if (lineType(line) == LT_TASK) {
+        marked_id = taskGetId((task_T) lineObj(line));
+        statusMessage("Task marked. Move it under another task with 'M'.");
+        move(cur_row, cur_col);
+      }
+      break;
+
+    case 'M': // Move marked task
+      if (lineType(line) == LT_CAT || lineType(line) == LT_TASK) {
+        // Like the template, the marked task may have been deleted since
+        task = listFindTaskById(list, marked_id);
+        if (!task) {
+          statusMessage("No task to move. Mark a task with 'm' first.");
+          move(cur_row, cur_col);
+          break;
+        }
+
+        task_T parent = NULL;
+        const char *category = NULL;
+        if (lineType(line) == LT_TASK) parent = (task_T) lineObj(line);
+        else category = catName((cat_T) lineObj(line));
+
+        if (listMoveSubtree(list, task, parent, NULL, category) == TD_OK) {
+          marked_id = TASK_NOID;
+          follow = task;
+          redraw = true;
+        } else {
+          statusMessage("Unable to move task there.");
+          move(cur_row, cur_col);
+        }
+      }
+      break;
+
+    case 'p': // Paste template
+      if (lineType(line) == LT_CAT || lineType(line) == LT_TASK) {
+        // The template is looked up by id in case it's since been deleted
+        task = listFindTaskById(list, template_id);
+        if (!task) {
+          statusMessage("No template to paste. Copy a task with 'y' first.");
+          move(cur_row, cur_col);
+          break;
+        }
+
+        task_T parent = NULL;
+        const char *category = NULL;
+        if (lineType(line) == LT_TASK) parent = (task_T) lineObj(line);
+        else category = catName((cat_T) lineObj(line));
+
+        if (listCloneSubtree(list, task, parent, category)) redraw = true;
+        else {
+          statusMessage("Unable to paste template.");
+          move(cur_row, cur_col);
+        }
+      }
+      break;
+
     case 'q': // Quit
-      if (listNumUpdates(list) == 0) return;
+      if (sessionNumUpdates(session) == 0) return;
       else if (filename) {
         statusMessage("Save changes before quitting? (y/n) ");
         if (getch() != 'y') return;
@@ -343,7 +688,9 @@ eventLoop(list_T list, const char *filename)
             has_backend = 1;
         }
 
-        if (has_backend && writeUpdates(list, filename) == TD_OK) return;
+        // Lists other than the one in view were read from the backend,
+        // so only it has to be checked
+        if (has_backend && sessionWriteUpdates(session) == TD_OK) return;
 
         statusMessage("Unable to save changes. Quit anyway? (y/n) ");
         if (getch() == 'y') return;
@@ -374,11 +721,24 @@ eventLoop(list_T list, const char *filename)
         }
 
         statusMessage("Save changes? (y/n) ");
-        if (getch() == 'y' && writeUpdates(list, filename) == TD_OK)
-          statusMessage("Changes successfully saved to backend.");
-        else
+        if (getch() == 'y' && writeUpdates(list, filename) == TD_OK) {
+          // Saving drops completed and deleted tasks from the list, so the
+          // screen's lines are rebuilt before they're used again
+          notice = "Changes successfully saved to backend.";
+          redraw = true;
+        } else {
           statusMessage("Changes not saved to backend.");
+          move(cur_row, cur_col);
+        }
+      }
+      break;
 
+    case 'u':        // Undo last change
+    case 'r' & 0x1f: // Redo undone change, Ctrl-R
+      rc = c == 'u' ? listUndo(list) : listRedo(list);
+      if (rc == TD_OK) redraw = true;
+      else {
+        statusMessage(c == 'u' ? "Nothing to undo." : "Nothing to redo.");
         move(cur_row, cur_col);
       }
       break;
@@ -390,8 +750,41 @@ eventLoop(list_T list, const char *filename)
       }
       break;
 
-    case 'x': // Mark task as complete
+    case 'V': // Switch saved view
+      if (viewSavedSwitcher(list, screen->view, &shown)) {
+        screen->view = shown;
+        screen->offset = 0;
+        cur_row = 0;
+
+        snprintf(msg, sizeof(msg), "Showing %s.", 
+          shown ? viewName(shown) : "all tasks");
+        notice = msg;
+      }
+
+      // The switcher drew over the list, so it's redrawn either way
+      redraw = true;
+      break;
+
+    case 'y': // Copy task as template
       if (lineType(line) == LT_TASK) {
+        template_id = taskGetId((task_T) lineObj(line));
+        statusMessage("Task and subtasks copied as template.");
+        move(cur_row, cur_col);
+      }
+      break;
+
+    case 'x': // Mark task as complete
+      if (sel.nids > 0) {
+        snprintf(msg, sizeof(msg), 
+          "Mark %d selected tasks and their subtasks as complete? (y/n) ",
+          sel.nids);
+        statusMessage(msg);
+        if (getch() != 'y') statusMessage("Tasks left unchanged.");
+        else if (selectionApply(&sel, list, LO_COMPLETE) == TD_OK) 
+          redraw = true;
+        else statusMessage("Unable to mark as complete.");
+        move(cur_row, cur_col);
+      } else if (lineType(line) == LT_TASK) {
         task = (task_T) lineObj(line);
         statusMessage("Mark as complete? (y/n) ");
         if (getch() != 'y') statusMessage("Task left unchanged.");
@@ -411,6 +804,14 @@ eventLoop(list_T list, const char *filename)
       }
       break;
 
+    case 'z': // Fold or unfold category
+      if (lineType(line) == LT_CAT) {
+        cat_T cat = (cat_T) lineObj(line);
+        catSetFolded(cat, !catIsFolded(cat));
+        redraw = true;
+      }
+      break;
+
     default:
       break;
 
@@ -421,12 +822,25 @@ eventLoop(list_T list, const char *filename)
       // TODO: only reset screen if an edit operation was made
       screenReset(&screen, list);
 
-      viewListScreen(screen, list);
+      // Keep the cursor on a task that moved, if it's still on screen
+      line_T found = screenFindLine(screen, follow);
+      if (found && lineNum(found) - screen->offset >= 0 &&
+          lineNum(found) - screen->offset < max_row - 1)
+        cur_row = lineNum(found) - screen->offset;
+      follow = NULL;
+
+      viewListScreen(screen, list, &sel);
       clearStatusLine();
       line = screenGetLine(screen, cur_row);
       move(cur_row, cur_col);
       chgat(-1, A_UNDERLINE, 0, NULL);
       redraw = false;
+
+      if (notice) {
+        statusMessage(notice);
+        move(cur_row, cur_col);
+        notice = NULL;
+      }
     }
 
   }
@@ -439,9 +853,9 @@ endwinAtExit()
 }
 
 void
-view(list_T list, const char *filename)
+view(session_T session)
 {
-  if (!(list && filename)) return;
+  if (!(session && sessionCurrent(session))) return;
   
   // Register this exit handler so that we can exit
   // the program within functions when errors occur
@@ -452,5 +866,5 @@ view(list_T list, const char *filename)
   noecho();
   curs_set(0);
 
-  eventLoop(list, filename);
+  eventLoop(session);
 }
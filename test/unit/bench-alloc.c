@@ -0,0 +1,138 @@
+//
+// -----------------------------------------------------------------------------
+// bench-alloc.c
+// -----------------------------------------------------------------------------
+//
+// Tyler Wayne (c) 2022
+//
+
+#include <stdio.h>        // printf, snprintf, fopen, fgets
+#include <stdlib.h>       // atoi
+#include <string.h>       // strsep, strcspn, strdup
+#include <malloc.h>       // mallinfo2
+#include <time.h>         // clock, CLOCKS_PER_SEC
+#include "mem.h"          // memCalloc, memFree
+#include "task.h"
+#include "list.h"         // listNew, listNewTask, listBulkLoad
+
+#ifndef TEST_DATA
+#define TEST_DATA "test/data/test-data.psv"
+#endif
+
+#define NTASKS  1000000
+#define MAX_COLS 32
+#define MAX_ROWS 64
+
+// Ids in the data are below this, so each copy of it gets ids of its own
+#define ID_STRIDE 100
+
+// Allocations are counted by wrapping glibc's allocator
+extern void *__libc_malloc(size_t), *__libc_calloc(size_t, size_t),
+  *__libc_realloc(void *, size_t);
+
+static long nallocs;
+
+void *malloc(size_t n) { nallocs++; return __libc_malloc(n); }
+void *calloc(size_t n, size_t size) { nallocs++; return __libc_calloc(n, size); }
+void *realloc(void *ptr, size_t n) { nallocs++; return __libc_realloc(ptr, n); }
+
+static char *keys[MAX_COLS];
+static char *rows[MAX_ROWS][MAX_COLS];
+static int nkeys, nrows;
+
+static int
+readData(const char *path)
+{
+  FILE *file = fopen(path, "r");
+  if (!file) return -1;
+
+  char line[1024];
+  for (int i=0; fgets(line, sizeof(line), file) && i <= MAX_ROWS; i++) {
+    line[strcspn(line, "\n")] = '\0';
+
+    char *rest = line, *field;
+    int n = 0;
+    while ((field = strsep(&rest, "|")) && n < MAX_COLS) {
+      if (i == 0) keys[n++] = strdup(field);
+      else rows[i-1][n++] = strdup(field);
+    }
+
+    if (i == 0) nkeys = n;
+    else nrows = i;
+  }
+
+  fclose(file);
+  return nrows ? 0 : -1;
+}
+
+// Sets the fields of the ith copy of a row of the data
+static void
+setFields(task_T task, const int i)
+{
+  char id[16], parent_id[16];
+  char **row = rows[i % nrows];
+  int offset = i / nrows * ID_STRIDE;
+
+  for (int k=0; k < nkeys; k++) {
+    const char *val = row[k] ? row[k] : "";
+    if (k < 2 && *val) {
+      snprintf(k ? parent_id : id, 16, "%d", atoi(val) + offset);
+      val = k ? parent_id : id;
+    }
+    taskSet(task, keys[k], val);
+  }
+}
+
+static void
+report(const char *label, const long allocs, const long heap,
+  const clock_t start)
+{
+  printf("%-26s %10ld allocations %7.1f MB heap %6.2f s\n", label, allocs,
+    heap / 1e6, (double) (clock() - start) / CLOCKS_PER_SEC);
+}
+
+int
+main(void)
+{
+  if (readData(TEST_DATA) != 0) {
+    printf("Couldn't read %s\n", TEST_DATA);
+    return 1;
+  }
+
+  task_T *tasks = memCalloc(NTASKS, sizeof(task_T));
+  if (!tasks) return 1;
+
+  // Tasks built on their own, as while editing
+  long heap = mallinfo2().uordblks;
+  clock_t start = clock();
+  nallocs = 0;
+
+  for (int i=0; i < NTASKS; i++) {
+    tasks[i] = taskNew();
+    setFields(tasks[i], i);
+  }
+
+  report("tasks on the heap", nallocs, mallinfo2().uordblks - heap, start);
+  for (int i=0; i < NTASKS; i++) taskFree(&tasks[i]);
+
+  // Tasks built in a list, as readTasks does
+  heap = mallinfo2().uordblks;
+  start = clock();
+  nallocs = 0;
+
+  list_T list = listNew("bench");
+  for (int k=0; k < nkeys; k++) listAddKey(list, keys[k]);
+  for (int i=0; i < NTASKS; i++) {
+    tasks[i] = listNewTask(list);
+    setFields(tasks[i], i);
+  }
+  listBulkLoad(list, tasks, NTASKS);
+
+  report("tasks loaded into a list", nallocs, mallinfo2().uordblks - heap,
+    start);
+
+  listFree(&list);
+  memFree(tasks);
+
+  return 0;
+}
@@ -0,0 +1,122 @@
+//
+// -----------------------------------------------------------------------------
+// bench-filter.c
+// -----------------------------------------------------------------------------
+//
+// Tyler Wayne (c) 2022
+//
+
+#include <stdio.h>        // printf, snprintf
+#include <time.h>         // clock, CLOCKS_PER_SEC
+#include "mem.h"          // memCalloc, memFree
+#include "task.h"
+#include "list.h"         // listBulkLoad, listSetColumns, listFilterTasks
+#include "filter.h"       // filterNew, filterFree
+
+#define NTASKS 1000000
+#define NRUNS  10
+
+static const char *queries[] = {
+  "priority=P0",
+  "status='In progress'",
+  "due_date<=2022-06-30 priority!=P3",
+  "category=Work name>='task 5'",
+  NULL
+};
+
+/**
+ * Builds a list of ntasks tasks spread over a few categories, with a
+ * priority, status and due date that vary from task to task
+ */
+static list_T
+makeList(const int ntasks)
+{
+  list_T list = listNew("bench");
+  if (!list) return NULL;
+
+  const char *keys[] = { "id", "parent_id", "category", "name", "position",
+    "priority", "status", "due_date", NULL };
+  for (int i=0; keys[i]; i++) listAddKey(list, keys[i]);
+
+  const char *categories[] = { "Work", "Work/ClientA", "Home", "Errands" };
+  const char *priorities[] = { "P0", "P1", "P2", "P3" };
+
+  task_T *tasks = memCalloc(ntasks, sizeof(task_T));
+  if (!tasks) return NULL;
+
+  char id[16], parent_id[16], name[32], due_date[16];
+  for (int i=0; i < ntasks; i++) {
+    snprintf(id, sizeof(id), "%d", i+1);
+    snprintf(parent_id, sizeof(parent_id), "%d", i);
+    snprintf(name, sizeof(name), "task %d", i+1);
+    snprintf(due_date, sizeof(due_date), "2022-%02d-%02d", i % 12 + 1,
+      i % 28 + 1);
+
+    // Every tenth task starts a new tree
+    tasks[i] = listNewTask(list);
+    taskSet(tasks[i], "id", id);
+    taskSet(tasks[i], "parent_id", i % 10 ? parent_id : "");
+    taskSet(tasks[i], "category", categories[i / 10 % 4]);
+    taskSet(tasks[i], "name", name);
+    taskSet(tasks[i], "priority", priorities[i * 7 % 4]);
+    taskSet(tasks[i], "status", i % 3 ? "Yet to start" : "In progress");
+    taskSet(tasks[i], "due_date", due_date);
+  }
+
+  listBulkLoad(list, tasks, ntasks);
+  memFree(tasks);
+
+  return list;
+}
+
+static double
+seconds(const clock_t start)
+{
+  return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+// Runs each query NRUNS times, and prints how many tasks it scanned a second
+static void
+benchQueries(list_T list, const char *label)
+{
+  for (int i=0; queries[i]; i++) {
+    filter_T filter = filterNew(queries[i]);
+    int n = 0;
+
+    clock_t start = clock();
+    for (int run=0; run < NRUNS; run++) {
+      task_T *tasks = listFilterTasks(list, filter);
+      for (n=0; tasks && tasks[n]; n++) ;
+      memFree(tasks);
+    }
+    double secs = seconds(start);
+
+    printf("%-8s %-36s %8d matches %8.1f M tasks/s\n", label, queries[i], n,
+      (double) NTASKS * NRUNS / secs / 1e6);
+    filterFree(&filter);
+  }
+}
+
+int
+main(void)
+{
+  list_T list = makeList(NTASKS);
+  if (!list) return 1;
+
+  benchQueries(list, "walk");
+  long size = listSize(list);
+
+  listSetColumns(list, 1);
+  clock_t start = clock();
+  filter_T filter = filterNew("id=0");
+  memFree(listFilterTasks(list, filter));
+  filterFree(&filter);
+  printf("filled columns in %.3f s, %ld MB on top of %ld MB\n",
+    seconds(start), (listSize(list) - size) >> 20, size >> 20);
+
+  benchQueries(list, "columns");
+
+  listFree(&list);
+
+  return 0;
+}
@@ -0,0 +1,69 @@
+//
+// -----------------------------------------------------------------------------
+// bench-keys.c
+// -----------------------------------------------------------------------------
+//
+// Tyler Wayne (c) 2022
+//
+
+#include <stdio.h>        // printf, snprintf
+#include <string.h>       // strdup
+#include <malloc.h>       // mallinfo2
+#include "mem.h"          // memCalloc, memFree
+#include "task.h"
+
+#define NTASKS 100000
+
+// The columns of test-data.psv
+static const char *keys[] = { "id", "parent_id", "category", "name",
+  "effort", "priority", "timing", "file_date", "due_date", "status",
+  "next_steps", "description", "keywords", NULL };
+
+static long
+heapInUse(void)
+{
+  return mallinfo2().uordblks;
+}
+
+int
+main(void)
+{
+  int nkeys = 0;
+  while (keys[nkeys]) nkeys++;
+
+  task_T *tasks = memCalloc(NTASKS, sizeof(task_T));
+  char **copies = memCalloc((long) NTASKS * nkeys, sizeof(char *));
+  if (!(tasks && copies)) return 1;
+
+  long start = heapInUse();
+
+  char val[64];
+  for (int i=0; i < NTASKS; i++) {
+    tasks[i] = taskNew();
+    for (int k=0; keys[k]; k++) {
+      if (k == 0) snprintf(val, sizeof(val), "%d", i+1);
+      else if (k == 3) snprintf(val, sizeof(val), "Task number %d", i+1);
+      else snprintf(val, sizeof(val), "v%d", k);
+      taskSet(tasks[i], keys[k], k < 10 ? val : "");
+    }
+  }
+
+  long interned = heapInUse() - start;
+
+  // What a copy of each key in each task, as taskSet made before keys
+  // were atoms, would add
+  start = heapInUse();
+  for (int i=0; i < NTASKS * nkeys; i++) copies[i] = strdup(keys[i % nkeys]);
+  long copied = heapInUse() - start;
+
+  printf("%d tasks x %d fields: %.1f MB with interned keys, "
+    "%.1f MB more with a copy of each key\n", NTASKS, nkeys, interned / 1e6,
+    copied / 1e6);
+
+  for (int i=0; i < NTASKS * nkeys; i++) memFree(copies[i]);
+  for (int i=0; i < NTASKS; i++) taskFree(&tasks[i]);
+  memFree(copies);
+  memFree(tasks);
+
+  return 0;
+}
@@ -0,0 +1,90 @@
+//
+// -----------------------------------------------------------------------------
+// bench-load.c
+// -----------------------------------------------------------------------------
+//
+// Tyler Wayne (c) 2022
+//
+
+#include <stdio.h>        // printf, snprintf
+#include <stdlib.h>       // srand, rand
+#include <time.h>         // clock, CLOCKS_PER_SEC
+#include "return-codes.h" // TD_OK
+#include "task.h"
+#include "list.h"         // listSetTask, listFindTaskById
+
+#define NLOOKUPS 1000000
+
+static const int sizes[] = { 10000, 20000, 50000, 100000, 200000, 500000,
+  1000000, 0 };
+
+static double
+seconds(const clock_t start)
+{
+  return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+/**
+ * Sets ntasks tasks one at a time, as they were once read from the
+ * database. Six in ten are nested under a random task set before them,
+ * and the rest start trees of their own
+ */
+static list_T
+loadList(const int ntasks)
+{
+  list_T list = listNew("bench");
+  if (!list) return NULL;
+
+  const char *keys[] = { "id", "parent_id", "category", "name", "position",
+    NULL };
+  for (int i=0; keys[i]; i++) listAddKey(list, keys[i]);
+
+  const char *categories[] = { "Work", "Home", "Errands" };
+
+  srand(1);
+  char id[16], parent_id[16], name[32];
+  for (int i=0; i < ntasks; i++) {
+    snprintf(id, sizeof(id), "%d", i+1);
+    snprintf(parent_id, sizeof(parent_id), "%d", i ? rand() % i + 1 : 0);
+    snprintf(name, sizeof(name), "task %d", i+1);
+
+    task_T task = listNewTask(list);
+    taskSet(task, "id", id);
+    taskSet(task, "parent_id", i && rand() % 10 < 6 ? parent_id : "");
+    taskSet(task, "category", categories[i % 3]);
+    taskSet(task, "name", name);
+    if (listSetTask(list, task) != TD_OK) {
+      listFree(&list);
+      return NULL;
+    }
+  }
+
+  return list;
+}
+
+int
+main(void)
+{
+  printf("%8s %10s %12s %14s\n", "tasks", "load s", "us/task", "lookups M/s");
+
+  for (int i=0; sizes[i]; i++) {
+    clock_t start = clock();
+    list_T list = loadList(sizes[i]);
+    if (!list) return 1;
+    double load = seconds(start);
+
+    int found = 0;
+    start = clock();
+    for (int j=0; j < NLOOKUPS; j++)
+      found += listFindTaskById(list, j % sizes[i] + 1) != NULL;
+    double lookup = seconds(start);
+
+    if (found != NLOOKUPS) return 1;
+
+    printf("%8d %10.3f %12.3f %14.1f\n", sizes[i], load,
+      load / sizes[i] * 1e6, NLOOKUPS / lookup / 1e6);
+    listFree(&list);
+  }
+
+  return 0;
+}
@@ -0,0 +1,642 @@
+//
+// -----------------------------------------------------------------------------
+// test-list.c
+// -----------------------------------------------------------------------------
+//
+// Tyler Wayne (c) 2022
+//
+
+#include <stdio.h>        // snprintf
+#include <string.h>       // strcmp, strcpy
+#include "minunit.h"
+#include "return-codes.h" // TD_OK
+#include "mem.h"          // memCalloc, memFree
+#include "atom.h"         // atomFind
+#include "task.h"
+#include "list.h"         // listBulkLoad, taskIterNext, listFilterTasks
+#include "filter.h"       // filterNew, filterFree
+#include "position.h"     // positionBetween
+#include "screen.h"       // screenInitialize
+
+#define WIDE 1000000
+#define DEEP 100000
+
+int tests_run = 0;
+
+/**
+ * Builds a list of ntasks tasks in one category. Each task is a subtask
+ * of the one before it when deep is set, otherwise they're all siblings
+ */
+static list_T
+makeList(const int ntasks, const int deep)
+{
+  list_T list = listNew("test");
+  if (!list) return NULL;
+
+  const char *keys[] = { "id", "parent_id", "category", "name", "position",
+    NULL };
+  for (int i=0; keys[i]; i++) listAddKey(list, keys[i]);
+
+  task_T *tasks = memCalloc(ntasks, sizeof(task_T));
+  if (!tasks) return NULL;
+
+  char id[16], parent_id[16];
+  for (int i=0; i < ntasks; i++) {
+    snprintf(id, sizeof(id), "%d", i+1);
+    snprintf(parent_id, sizeof(parent_id), "%d", i);
+
+    tasks[i] = listNewTask(list);
+    taskSet(tasks[i], "id", id);
+    taskSet(tasks[i], "parent_id", deep && i ? parent_id : "");
+    taskSet(tasks[i], "category", "Test");
+    taskSet(tasks[i], "name", id);
+  }
+
+  listBulkLoad(list, tasks, ntasks);
+  memFree(tasks);
+
+  return list;
+}
+
+static int
+countTasks(struct taskIter *it, int *maxdepth, const int skipdepth)
+{
+  int n = 0;
+  *maxdepth = 0;
+
+  while (taskIterNext(it)) {
+    n++;
+    if (it->depth > *maxdepth) *maxdepth = it->depth;
+    if (it->depth == skipdepth) taskIterSkip(it);
+  }
+
+  return n;
+}
+
+static int
+countMatches(list_T list, const char *query)
+{
+  filter_T filter = filterNew(query);
+  if (!filter) return -1;
+
+  task_T *tasks = listFilterTasks(list, filter);
+  int n;
+  for (n=0; tasks && tasks[n]; n++) ;
+  memFree(tasks);
+  filterFree(&filter);
+
+  return tasks ? n : -1;
+}
+
+static char
+*test_fields()
+{
+  task_T task = taskNew();
+  if (!task) return "Failed to make task";
+
+  taskSet(task, "name", "A name that's too long to be short");
+  taskSet(task, "effort", "S");
+
+  // Adding fields moves short values, which are held in the fields, so
+  // they have to be copied out when set from the same task
+  char key[16];
+  for (int i=0; i < 100; i++) {
+    snprintf(key, sizeof(key), "key%d", i);
+    taskSet(task, key, taskGet(task, i ? "key0" : "effort"));
+  }
+
+  if (strcmp(taskGet(task, "name"), "A name that's too long to be short"))
+    return "Setting other fields changed a long value";
+  if (strcmp(taskGet(task, "effort"), "S") != 0)
+    return "Setting other fields changed a short value";
+  if (strcmp(taskGet(task, "key99"), "S") != 0)
+    return "Value set from the same task was changed";
+
+  // A list's tasks have their fields up front, so values stay put as
+  // the list's keys are set
+  list_T list = listNew("fields");
+  if (!list) return "Failed to make list";
+  listAddKey(list, "name");
+  listAddKey(list, "effort");
+  for (int i=0; i < 10; i++) {
+    snprintf(key, sizeof(key), "key%d", i);
+    listAddKey(list, key);
+  }
+
+  task_T listed = listNewTask(list);
+  if (!listed) return "Failed to make list task";
+  taskSet(listed, "effort", "S");
+  const char *effort = taskGet(listed, "effort");
+  for (int i=0; i < 10; i++) {
+    snprintf(key, sizeof(key), "key%d", i);
+    taskSet(listed, key, "value");
+  }
+  taskSet(listed, "name", "A name that's too long to be short");
+
+  if (taskGet(listed, "effort") != effort) return "Setting a key moved a value";
+  if (strcmp(effort, "S") != 0) return "Value was changed";
+  taskFree(&listed);
+  listFree(&list);
+
+  // Asking whether a key is interned doesn't make it an atom
+  if (taskKeyIsInterned("a key no task has")) return "Key was interned";
+  if (atomFind("a key no task has")) return "Lookup interned the key";
+
+  taskFree(&task);
+  mu_assert("Failed to free task", task == NULL);
+}
+
+static char
+*test_wide()
+{
+  list_T list = makeList(WIDE, 0);
+  if (!list) return "Failed to make wide list";
+
+  cat_T cat = listGetCat(list, NULL);
+  if (catNumOpen(cat) != WIDE) return "Wide list has wrong open count";
+
+  struct taskIter it;
+  int maxdepth;
+
+  catIterInit(&it, cat);
+  if (countTasks(&it, &maxdepth, -1) != WIDE || maxdepth != 0)
+    return "Wide walk didn't visit every sibling once";
+
+  catIterInit(&it, cat);
+  if (countTasks(&it, &maxdepth, 0) != WIDE)
+    return "Skipping leaves cut short the wide walk";
+
+  // A task's walk doesn't go on to its siblings
+  taskIterInit(&it, catGetTask(cat, NULL));
+  if (countTasks(&it, &maxdepth, -1) != 1)
+    return "Task walk left its subtree";
+
+  screen_T screen = screenNew();
+  screenInitialize(screen, list);
+  int nlines = screen->nlines;
+  screenFree(&screen);
+  if (nlines != WIDE + 1) return "Wide screen has wrong number of lines";
+
+  listFree(&list);
+  mu_assert("Failed to free wide list", list == NULL);
+}
+
+static char
+*test_deep()
+{
+  list_T list = makeList(DEEP, 1);
+  if (!list) return "Failed to make deep list";
+
+  cat_T cat = listGetCat(list, NULL);
+  task_T root = catGetTask(cat, NULL);
+  task_T leaf = listFindTaskById(list, DEEP);
+  if (taskGetLevel(leaf) != DEEP - 1) return "Deep list has wrong levels";
+  if (taskNumSubtasks(root) != DEEP - 1) return "Deep list has wrong counts";
+
+  struct taskIter it;
+  int maxdepth;
+
+  catIterInit(&it, cat);
+  if (countTasks(&it, &maxdepth, -1) != DEEP || maxdepth != DEEP - 1)
+    return "Deep walk didn't reach the bottom";
+
+  taskIterInit(&it, root);
+  if (countTasks(&it, &maxdepth, 10) != 11 || maxdepth != 10)
+    return "Deep walk wasn't pruned";
+
+  screen_T screen = screenNew();
+  screenInitialize(screen, list);
+  int nlines = screen->nlines;
+  screenFree(&screen);
+  if (nlines != DEEP + 1) return "Deep screen has wrong number of lines";
+
+  if (!taskIsDescendant(leaf, root) || taskIsDescendant(root, leaf))
+    return "Deep list has wrong ancestors";
+
+  task_T copy = listCloneSubtree(list, root, NULL, NULL);
+  if (!copy) return "Failed to clone deep list";
+  if (catNumOpen(cat) != 2 * DEEP) return "Clone has wrong open count";
+
+  taskIterInit(&it, copy);
+  if (countTasks(&it, &maxdepth, -1) != DEEP || maxdepth != DEEP - 1)
+    return "Clone isn't as deep as the original";
+
+  markDelete(list, root);
+  if (catNumOpen(cat) != DEEP) return "Delete left tasks open";
+  if (!taskGetFlag(leaf, TF_DELETE)) return "Delete didn't reach the bottom";
+
+  listFree(&list);
+  mu_assert("Failed to free deep list", list == NULL);
+}
+
+static char
+*test_cycles()
+{
+  list_T list = listNew("test");
+  if (!list) return "Failed to make list";
+
+  const char *keys[] = { "id", "parent_id", "category", "name", NULL };
+  for (int i=0; keys[i]; i++) listAddKey(list, keys[i]);
+
+  // Tasks 2 and 3 are each other's parents, and task 1 is below them but
+  // comes first
+  const char *rows[][2] = { { "1", "2" }, { "2", "3" }, { "3", "2" } };
+  task_T tasks[3];
+  for (int i=0; i < 3; i++) {
+    tasks[i] = listNewTask(list);
+    taskSet(tasks[i], "id", rows[i][0]);
+    taskSet(tasks[i], "parent_id", rows[i][1]);
+    taskSet(tasks[i], "category", "Test");
+    taskSet(tasks[i], "name", rows[i][0]);
+  }
+
+  if (listBulkLoad(list, tasks, 3) != TD_OK) return "Failed to load tasks";
+
+  cat_T cat = listGetCat(list, NULL);
+  task_T top = catGetTask(cat, NULL), task = listFindTaskById(list, 1);
+  if (taskGetId(top) != 2 || catNumOpen(cat) != 3)
+    return "Cycle wasn't broken at one of its tasks";
+  if (taskGetLevel(task) != 1 || !taskIsDescendant(task, top))
+    return "Task below the cycle lost its parent";
+  if (taskNumSubtasks(top) != 2) return "Cycle has wrong counts";
+
+  listFree(&list);
+  mu_assert("Failed to free list", list == NULL);
+}
+
+static char
+*test_positions()
+{
+  char pos[POSITION_LEN], lo[POSITION_LEN] = "a0", hi[POSITION_LEN] = "a1";
+
+  // Moving into the same gap again and again only lengthens the position
+  for (int i=0; i < 40; i++) {
+    if (positionBetween(pos, sizeof(pos), lo, hi) != TD_OK) 
+      return "No position between two positions";
+    if (!(strcmp(lo, pos) < 0 && strcmp(pos, hi) < 0)) 
+      return "Position isn't between its neighbors";
+    strcpy(i % 2 ? lo : hi, pos);
+  }
+
+  list_T list = makeList(100, 0);
+  if (!list) return "Failed to make list";
+
+  // Tasks are prepended, so the first is the last one added
+  cat_T cat = listGetCat(list, NULL);
+  task_T first = catGetTask(cat, NULL);
+  if (taskGetId(first) != 100) return "Tasks were loaded out of order";
+
+  if (listMoveTask(list, first, -1) == TD_OK) return "First task moved up";
+  if (listMoveTask(list, first, 1) != TD_OK) return "Failed to move task down";
+  if (catGetTask(cat, NULL) == first) return "Task didn't move down";
+
+  for (int i=0; i < 50; i++) listMoveTask(list, first, 1);
+  listMoveTask(list, first, -1);
+
+  // Positions follow the order of the siblings
+  int n = 0;
+  const char *prev = NULL;
+  for (task_T task=cat->tasks; task; task=taskGetNext(task), n++) {
+    const char *task_pos = taskGet(task, "position");
+    if (prev && strcmp(prev, task_pos) >= 0) return "Positions are out of order";
+    if (task == first && n != 50) return "Task is in the wrong place";
+    prev = task_pos;
+  }
+
+  listFree(&list);
+  mu_assert("Lost tasks while moving them", n == 100);
+}
+
+static char
+*test_moves()
+{
+  list_T list = makeList(DEEP, 1);
+  if (!list) return "Failed to make list";
+  listClearUpdates(list);
+
+  cat_T cat = listGetCat(list, NULL);
+  task_T root = catGetTask(cat, NULL);
+  task_T task = listFindTaskById(list, 10), leaf = listFindTaskById(list, DEEP);
+
+  if (listMoveSubtree(list, root, task, NULL, NULL) == TD_OK)
+    return "Task moved under its own subtask";
+  if (listOutdentTask(list, root) == TD_OK) return "Top-level task outdented";
+
+  // Moving a deep subtree up a level doesn't write its subtasks, but the
+  // siblings it joins are given positions, not having any yet
+  if (listOutdentTask(list, task) != TD_OK) return "Failed to outdent task";
+  if (taskGetParentId(task) != 8)
+    return "Outdented task has the wrong parent";
+  if (taskGetLevel(leaf) != DEEP - 2) return "Outdent didn't shift levels";
+  if (taskNumSubtasks(root) != DEEP - 1) return "Outdent changed counts";
+  if (listNumUpdates(list) != 2) return "Outdent wrote its subtasks";
+  listClearUpdates(list);
+
+  if (listIndentTask(list, task) != TD_OK) return "Failed to indent task";
+  if (taskGetParentId(task) != 9) return "Indented task has the wrong parent";
+  if (taskNumSubtasks(listFindTaskById(list, 9)) != DEEP - 9)
+    return "Indent didn't move counts";
+  if (listNumUpdates(list) != 1) return "Indent wrote more than its root";
+
+  // A new category is written all the way down
+  if (listMoveSubtree(list, task, NULL, NULL, "Other") != TD_OK)
+    return "Failed to move task to another category";
+  if (taskNumSubtasks(root) != 8 || catNumOpen(cat) != 9)
+    return "Moved subtree still counted in its old category";
+  // Categories are in alphabetical order
+  if (catNumOpen(listGetCat(list, NULL)) != DEEP - 9)
+    return "Moved subtree isn't counted in its new category";
+  if (strcmp(taskGet(leaf, "category"), "Other"))
+    return "Subtasks weren't moved to the new category";
+  if (listNumUpdates(list) != DEEP - 9) return "Wrong number of updates";
+
+  listFree(&list);
+  mu_assert("Failed to free list", list == NULL);
+}
+
+static char
+*test_categories()
+{
+  list_T list = makeList(10, 0);
+  if (!list) return "Failed to make list";
+
+  cat_T cat = listGetCat(list, NULL);
+  task_T task = catGetTask(cat, NULL);
+  if (listMoveSubtree(list, task, NULL, NULL, "Test/A/B") != TD_OK)
+    return "Failed to move task to a nested category";
+  if (list->ncats != 3) return "Nested category didn't make its parents";
+
+  int depth, maxdepth = 0, n = 0;
+  cat_T nested = NULL;
+  while ((nested = listNextCat(list, nested, 0, &depth))) {
+    n++;
+    if (depth > maxdepth) maxdepth = depth;
+  }
+  if (n != 3 || maxdepth != 2) return "Walk didn't reach the nested category";
+  if (strcmp(catLabel(cat->child->child), "B")) return "Wrong label";
+  if (catNumBranchOpen(cat) != 10 || catNumOpen(cat) != 9)
+    return "Branch doesn't count its nested categories";
+
+  screen_T screen = screenNew();
+  catSetFolded(cat, 1);
+  screenInitialize(screen, list);
+  if (screen->nlines != 1) return "Folded category wasn't hidden";
+  catSetFolded(cat, 0);
+  screenReset(&screen, list);
+  if (screen->nlines != 13) return "Nested categories weren't shown";
+  screenFree(&screen);
+
+  // Emptied categories go, up to the first one that isn't empty
+  if (listMoveSubtree(list, task, NULL, NULL, "Test") != TD_OK)
+    return "Failed to move task back";
+  if (list->ncats != 1 || cat->child) return "Empty categories were kept";
+
+  listFree(&list);
+  mu_assert("Failed to free list", list == NULL);
+}
+
+static char
+*test_undo()
+{
+  list_T list = makeList(DEEP, 1);
+  if (!list) return "Failed to make list";
+  listClearUpdates(list);
+
+  if (listUndo(list) == TD_OK) return "Undid without a history";
+  if (listSetHistory(list, 10) != TD_OK) return "Failed to keep a history";
+
+  cat_T cat = listGetCat(list, NULL);
+  task_T root = catGetTask(cat, NULL), task = listFindTaskById(list, 10);
+
+  if (listOutdentTask(list, task) != TD_OK) return "Failed to outdent task";
+  task_T copy = listCloneSubtree(list, task, NULL, NULL);
+  if (!copy) return "Failed to clone task";
+  if (markDelete(list, root) != TD_OK) return "Failed to delete task";
+  if (catNumOpen(cat) != DEEP - 9) return "Delete left tasks open";
+
+  for (int i=0; i < 3; i++)
+    if (listUndo(list) != TD_OK) return "Failed to undo";
+  if (listUndo(list) == TD_OK) return "Undid more than was done";
+
+  if (catNumOpen(cat) != DEEP || taskNumSubtasks(root) != DEEP - 1)
+    return "Undo didn't restore counts";
+  if (taskGetParentId(task) != 9) return "Undo didn't move task back";
+  if (listFindTaskById(list, taskGetId(copy))) return "Undo left the clone";
+  if (listNumUpdates(list) != 0) return "Undo left updates";
+
+  for (int i=0; i < 3; i++)
+    if (listRedo(list) != TD_OK) return "Failed to redo";
+
+  if (catNumOpen(cat) != DEEP - 9 || !taskGetFlag(root, TF_DELETE))
+    return "Redo didn't delete task";
+  if (listFindTaskById(list, taskGetId(copy)) != copy)
+    return "Redo didn't restore the clone";
+
+  // Undone changes can't be redone after a new one
+  listUndo(list);
+  if (listMoveTask(list, copy, 1) != TD_OK) return "Failed to move task";
+  if (listRedo(list) == TD_OK) return "Redid past a new change";
+
+  // A new task that's deleted stays among the updates, for the backends
+  // to skip, so the count matches them
+  if (markDelete(list, copy) != TD_OK) return "Failed to delete clone";
+  task_T *updates = listGetUpdates(list);
+  int n;
+  for (n=0; updates && updates[n]; n++) ;
+  memFree(updates);
+  if (n != listNumUpdates(list)) return "Updates don't match their count";
+
+  listFree(&list);
+  mu_assert("Failed to free list", list == NULL);
+}
+
+static char
+*test_views()
+{
+  list_T list = makeList(WIDE, 0);
+  if (!list) return "Failed to make list";
+
+  if (listAddView(list, "bad", "name")) return "Added an invalid view";
+  if (listAddView(list, "bad", "position<a5")) return "Added a position view";
+
+  // Names are ids, so these are 5, 50-59, 500-599, ..., 500000-599999
+  view_T view = listAddView(list, "fives", "name>=5 name<6");
+  if (!view) return "Failed to add view";
+  if (listGetView(list, "fives") != view) return "Failed to get view";
+  if (listViewNumTasks(list, view) != 111111) return "Wrong tasks in view";
+
+  task_T task = listFindTaskById(list, 5);
+  if (markComplete(list, task) != TD_OK) return "Failed to complete task";
+  if (markDelete(list, listFindTaskById(list, 50)) != TD_OK)
+    return "Failed to delete task";
+  task = listFindTaskById(list, 7);
+  if (listApply(list, &task, 1, LO_SET, "name", "5") != TD_OK)
+    return "Failed to rename task";
+  if (listViewNumTasks(list, view) != 111110) return "View wasn't updated";
+
+  task_T *tasks = listViewGetTasks(list, view);
+  if (!tasks || taskGetId(tasks[0]) != 7) return "View isn't sorted by id";
+  memFree(tasks);
+
+  screen_T screen = screenNew();
+  screen->view = view;
+  screenInitialize(screen, list);
+  if (screen->nlines != 111111) return "Screen doesn't show the view";
+  screenFree(&screen);
+
+  listFree(&list);
+  mu_assert("Failed to free list", list == NULL);
+}
+
+static char
+*test_columns()
+{
+  list_T list = makeList(WIDE, 0);
+  if (!list) return "Failed to make list";
+  if (listSetColumns(list, 1) != TD_OK) return "Failed to keep columns";
+
+  // Names are ids, so these are 5, 50-59, 500-599, ..., 500000-599999
+  filter_T filter = filterNew("name>=5 name<6 category=Test");
+  if (!filter) return "Failed to make filter";
+
+  task_T *tasks = listFilterTasks(list, filter);
+  int n;
+  for (n=0; tasks && tasks[n]; n++) ;
+  memFree(tasks);
+  if (n != 111111) return "Columns found the wrong tasks";
+
+  task_T task = listFindTaskById(list, 7);
+  if (listApply(list, &task, 1, LO_SET, "name", "5") != TD_OK)
+    return "Failed to rename task";
+  if (!listCloneSubtree(list, task, NULL, NULL)) return "Failed to clone task";
+
+  tasks = listFilterTasks(list, filter);
+  for (n=0; tasks && tasks[n]; n++) ;
+  memFree(tasks);
+  if (n != 111113) return "Columns weren't updated";
+
+  filterFree(&filter);
+  filter = filterNew("category=Other");
+  tasks = listFilterTasks(list, filter);
+  if (!tasks || tasks[0]) return "Columns matched a missing value";
+  memFree(tasks);
+  filterFree(&filter);
+
+  listFree(&list);
+  mu_assert("Failed to free list", list == NULL);
+}
+
+static char
+*test_noid()
+{
+  list_T list = makeList(3, 0);
+  if (!list) return "Failed to make list";
+  if (listSetHistory(list, 10) != TD_OK) return "Failed to keep a history";
+  if (listSetColumns(list, 1) != TD_OK) return "Failed to keep columns";
+
+  view_T view = listAddView(list, "test", "category=Test");
+  if (listViewNumTasks(list, view) != 3) return "Wrong tasks in view";
+
+  // A task without an id is in the list, though it isn't in the index
+  task_T parent = listFindTaskById(list, 1), task = listNewTask(list);
+  taskSet(task, "parent_id", "1");
+  taskSet(task, "category", "Test");
+  taskSet(task, "name", "no id");
+  if (listSetTask(list, task) != TD_OK) return "Failed to set task";
+  if (countMatches(list, "name='no id'") != 1) return "Task wasn't found";
+
+  // Without columns, every task in the list is walked, and each matches
+  listSetColumns(list, 0);
+  if (countMatches(list, "category=Test") != 4) return "Walk missed tasks";
+  if (listSetColumns(list, 1) != TD_OK) return "Failed to keep columns";
+
+  if (listOutdentTask(list, task) != TD_OK) return "Failed to outdent task";
+  if (listUndo(list) != TD_OK) return "Failed to undo";
+  if (!taskIsDescendant(task, parent)) return "Undo didn't move task back";
+  if (countMatches(list, "name='no id'") != 1) return "Undo lost the task";
+
+  if (listRedo(list) != TD_OK) return "Failed to redo";
+  if (taskIsDescendant(task, parent)) return "Redo didn't move task";
+  if (countMatches(list, "name='no id'") != 1) return "Redo lost the task";
+
+  // Views hold it too, whether they're kept up to date or built again
+  if (listViewNumTasks(list, view) != 4) return "View missed the task";
+  listAddView(list, "test", "category=Test");
+  if (listViewNumTasks(list, view) != 4) return "Rebuilt view missed the task";
+  if (markDelete(list, task) != TD_OK) return "Failed to delete task";
+  if (listViewNumTasks(list, view) != 3) return "View kept deleted task";
+
+  listFree(&list);
+  mu_assert("Failed to free list", list == NULL);
+}
+
+static char
+*test_reuse()
+{
+  list_T list = makeList(1000, 0);
+  if (!list) return "Failed to make list";
+
+  char name[64];
+  long size = 0;
+
+  // Values that are replaced, and tasks that are cloned and then dropped,
+  // give their memory back to the list
+  for (int round=0; round < 50; round++) {
+    task_T task = listFindTaskById(list, 1);
+    for (int i=1; i <= 1000; i++) {
+      snprintf(name, sizeof(name), "Task %d, renamed %d times", i, round);
+      taskSet(listFindTaskById(list, i), "name", name);
+    }
+
+    task_T copy = listCloneSubtree(list, task, NULL, NULL);
+    if (!copy || markDelete(list, copy) != TD_OK)
+      return "Failed to clone and delete task";
+    listClearUpdates(list);
+    listCompact(list);
+
+    if (round == 1) size = listSize(list);
+  }
+
+  if (listSize(list) != size) return "List grew as fields were set";
+
+  listFree(&list);
+  mu_assert("Failed to free list", list == NULL);
+}
+
+static char *
+run_all_tests()
+{
+  char *(*all_tests[])() = {
+    test_fields,
+    test_wide,
+    test_deep,
+    test_cycles,
+    test_positions,
+    test_moves,
+    test_categories,
+    test_undo,
+    test_views,
+    test_columns,
+    test_noid,
+    test_reuse,
+    NULL
+  };
+
+  // Returns message of first failing test
+  mu_run_all(all_tests);
+
+  return 0;
+}
+
+int
+main(void)
+{
+  char* result = run_all_tests();
+
+  if (result != 0) printf("%s\n", result);
+  else printf("ALL TESTS PASSED\n");
+
+  printf("Tests run: %d\n", tests_run);
+
+  return result != 0;
+}